@@ -79,10 +79,18 @@ usage()
 #else
     << "        Default: +/share/arachne-pnr/chipdb-<device>.bin\n"
 #endif
+    << "        If the executable was built with the chipdb for <device>\n"
+    << "        embedded (make bin/arachne-pnr-embedded), that is used\n"
+    << "        instead of the default file.\n"
     << "\n"
     << "    --write-binary-chipdb <file>\n"
     << "        Write binary chipdb to <file>.\n"
     << "\n"
+    << "    --cache-dir <dir>\n"
+    << "        When reading a text chipdb, keep its binary form in <dir>,\n"
+    << "        keyed by a hash of the chipdb contents and the arachne-pnr\n"
+    << "        version, and read that instead on later runs.\n"
+    << "\n"
     << "    -l, --no-promote-globals\n"
     << "        Don't promote nets to globals.\n"
     << "\n"
@@ -111,6 +119,66 @@ usage()
     << "        Maximum number of routing passes.\n"
     << "        Default: 200\n"
     << "\n"
+    << "    --route-stall-passes <int>\n"
+    << "        Give up routing if the number of overused routing resources\n"
+    << "        hasn't improved in <int> passes, and log the most contested\n"
+    << "        resources and the nets using them.  0 disables.\n"
+    << "        Default: 0\n"
+    << "\n"
+    << "    --route-bb-margin <int>\n"
+    << "        Restrict the routing search for each net to its pin bounding box\n"
+    << "        expanded by <int> tiles.  The box is widened for nets that fail\n"
+    << "        to route inside it.  0 searches the whole chip.\n"
+    << "        Default: 0\n"
+    << "\n"
+    << "    --route-threads <int>\n"
+    << "        Reroute up to <int> congested nets at a time on separate\n"
+    << "        threads.  Routes found are the same for any <int>.\n"
+    << "        Default: 1\n"
+    << "\n"
+    << "    --route-astar\n"
+    << "        Guide the routing search toward each net's sinks with an\n"
+    << "        estimate of the remaining cost (A*).  Faster, but the\n"
+    << "        estimate is sampled, so routes may differ.\n"
+    << "\n"
+    << "    --route-bidir\n"
+    << "        Route two-pin nets by searching from both pins at once.\n"
+    << "        Faster on large chips, but may pick different routes.\n"
+    << "\n"
+    << "    --route-timing-driven\n"
+    << "        Weigh the estimated delay of critical connections against\n"
+    << "        congestion when routing.\n"
+    << "\n"
+    << "    --route-net-order <order>\n"
+    << "        Order in which nets are routed in each pass.  One of:\n"
+    << "          index       - netlist order\n"
+    << "          fanout      - highest fanout first\n"
+    << "          bbox        - largest pin bounding box first\n"
+    << "          criticality - most timing-critical first\n"
+    << "          random      - shuffled every pass (see --seed)\n"
+    << "        Default: index\n"
+    << "\n"
+    << "    --route-high-fanout <int>\n"
+    << "        Before the main routing passes, route non-global nets with at\n"
+    << "        least <int> sinks on their own until they don't overlap.\n"
+    << "        Default: 0 (disabled)\n"
+    << "\n"
+    << "    --route-warm-start <asc-file>\n"
+    << "        Keep the routes in <asc-file>, a previous output, for nets\n"
+    << "        whose pins they still connect.  Other nets, and kept nets\n"
+    << "        that end up congested, are routed as usual.\n"
+    << "\n"
+    << "    --route-stats <file>\n"
+    << "        Write per-pass router statistics (search effort, overused\n"
+    << "        nodes, most congested tiles) to <file>.\n"
+    << "\n"
+    << "    --route-utilization <file>\n"
+    << "        Write per-tile routing utilization (local, span4, span12,\n"
+    << "        global) and the placer's estimated demand to <file> as CSV.\n"
+    << "\n"
+    << "    --route-heatmap\n"
+    << "        Log an ASCII map of routing utilization and placer demand.\n"
+    << "\n"
     << "    -s <int>, --seed <int>\n"
     << "        Set seed for random generator to <int>.\n"
     << "        Default: 1\n"
@@ -125,6 +193,28 @@ usage()
     << "        Print version and exit.\n";
 }
 
+int
+parse_unsigned_option(const char *str, const char *what)
+{
+  std::string s = str;
+  
+  if (s.empty())
+    fatal(fmt("invalid empty " << what));
+  
+  int x = 0;
+  for (char ch : s)
+    {
+      if (ch >= '0'
+          && ch <= '9')
+        x = x * 10 + (unsigned)(ch - '0');
+      else
+        fatal(fmt("invalid character `"
+                  << ch
+                  << "' in unsigned integer literal in " << what));
+    }
+  return x;
+}
+
 struct null_ostream : public std::ostream
 {
   null_ostream() : std::ostream(0) {}
@@ -151,7 +241,11 @@ main(int argc, const char **argv)
     quiet = false,
     do_promote_globals = true,
     route_only = false,
-    randomize_seed = false;
+    randomize_seed = false,
+    route_astar = false,
+    route_bidir = false,
+    route_timing_driven = false,
+    route_heatmap = false;
   std::string device = "1k";
   const char *chipdb_file = nullptr,
     *input_file = nullptr,
@@ -164,7 +258,16 @@ main(int argc, const char **argv)
     *output_file = nullptr,
     *seed_str = nullptr,
     *max_passes_str = nullptr,
-    *binary_chipdb = nullptr;
+    *route_stall_passes_str = nullptr,
+    *route_bb_margin_str = nullptr,
+    *route_threads_str = nullptr,
+    *route_net_order_str = nullptr,
+    *route_high_fanout_str = nullptr,
+    *route_warm_start = nullptr,
+    *route_stats = nullptr,
+    *route_utilization = nullptr,
+    *binary_chipdb = nullptr,
+    *cache_dir = nullptr;
 
   for (int i = 1; i < argc; ++i)
     {
@@ -202,6 +305,14 @@ main(int argc, const char **argv)
               ++i;
               binary_chipdb = argv[i];
             }
+          else if (!strcmp(argv[i], "--cache-dir"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+
+              ++i;
+              cache_dir = argv[i];
+            }
           else if (!strcmp(argv[i], "-l")
                    || !strcmp(argv[i], "--no-promote-globals"))
             do_promote_globals = false;
@@ -280,6 +391,78 @@ main(int argc, const char **argv)
               ++i;
               max_passes_str = argv[i];
             }
+          else if (!strcmp(argv[i], "--route-stall-passes"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+
+              ++i;
+              route_stall_passes_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--route-bb-margin"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+
+              ++i;
+              route_bb_margin_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--route-threads"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+
+              ++i;
+              route_threads_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--route-astar"))
+            route_astar = true;
+          else if (!strcmp(argv[i], "--route-bidir"))
+            route_bidir = true;
+          else if (!strcmp(argv[i], "--route-timing-driven"))
+            route_timing_driven = true;
+          else if (!strcmp(argv[i], "--route-net-order"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+
+              ++i;
+              route_net_order_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--route-high-fanout"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+
+              ++i;
+              route_high_fanout_str = argv[i];
+            }
+          else if (!strcmp(argv[i], "--route-utilization"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+
+              ++i;
+              route_utilization = argv[i];
+            }
+          else if (!strcmp(argv[i], "--route-heatmap"))
+            route_heatmap = true;
+          else if (!strcmp(argv[i], "--route-warm-start"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+
+              ++i;
+              route_warm_start = argv[i];
+            }
+          else if (!strcmp(argv[i], "--route-stats"))
+            {
+              if (i + 1 >= argc)
+                fatal(fmt(argv[i] << ": expected argument"));
+
+              ++i;
+              route_stats = argv[i];
+            }
           else if (!strcmp(argv[i], "-o")
                    || !strcmp(argv[i], "--output-file"))
             {
@@ -365,27 +548,42 @@ main(int argc, const char **argv)
   else
     seed = 1;
 
-  int max_passes = 0;
+  RouteOptions route_opts;
   if (max_passes_str)
+    route_opts.max_passes = parse_unsigned_option(max_passes_str,
+                                                  "max-passes value");
+  if (route_stall_passes_str)
+    route_opts.stall_passes = parse_unsigned_option(route_stall_passes_str,
+                                                    "route-stall-passes value");
+  if (route_bb_margin_str)
+    route_opts.bb_margin = parse_unsigned_option(route_bb_margin_str,
+                                                 "route-bb-margin value");
+  if (route_threads_str)
+    route_opts.threads = parse_unsigned_option(route_threads_str,
+                                               "route-threads value");
+  route_opts.astar = route_astar;
+  route_opts.bidir = route_bidir;
+  route_opts.timing_driven = route_timing_driven;
+  route_opts.heatmap = route_heatmap;
+  if (route_net_order_str)
     {
-      std::string max_passes_s = max_passes_str;
-
-      if (max_passes_s.empty())
-        fatal("invalid empty max-passes value");
-
-      for (char ch : max_passes_s)
-        {
-          if (ch >= '0'
-              && ch <= '9')
-            max_passes = max_passes * 10 + (unsigned)(ch - '0');
-          else
-            fatal(fmt("invalid character `"
-                      << ch
-                      << "' in unsigned integer literal in max-passes value"));
-        }
+      std::string order = route_net_order_str;
+      if (order == "index")
+        route_opts.net_order = RouteNetOrder::INDEX;
+      else if (order == "fanout")
+        route_opts.net_order = RouteNetOrder::FANOUT;
+      else if (order == "bbox")
+        route_opts.net_order = RouteNetOrder::BBOX;
+      else if (order == "criticality")
+        route_opts.net_order = RouteNetOrder::CRITICALITY;
+      else if (order == "random")
+        route_opts.net_order = RouteNetOrder::RANDOM;
+      else
+        fatal(fmt("unknown route net order `" << order << "'"));
     }
-  else
-    max_passes = 200;
+  if (route_high_fanout_str)
+    route_opts.high_fanout = parse_unsigned_option(route_high_fanout_str,
+                                                   "route-high-fanout value");
 
   if (randomize_seed)
     {
@@ -402,21 +600,32 @@ main(int argc, const char **argv)
   random_generator rg(seed);
 
   *logs << "device: " << device << "\n";
-  std::string chipdb_file_s;
-  if (chipdb_file)
-    chipdb_file_s = chipdb_file;
-  else
+  const ChipDB *chipdb = nullptr;
+  if (!chipdb_file)
+    {
+      chipdb = read_embedded_chipdb(device);
+      if (chipdb)
+        *logs << "read_chipdb <embedded>...\n";
+    }
+  if (!chipdb)
+    {
+      std::string chipdb_file_s;
+      if (chipdb_file)
+        chipdb_file_s = chipdb_file;
+      else
 #if defined(_WIN32) && defined(MXE_DIR_STRUCTURE)
-    chipdb_file_s = (std::string("+/chipdb-")
-                     + device
-                     + ".bin");
+        chipdb_file_s = (std::string("+/chipdb-")
+                         + device
+                         + ".bin");
 #else
-    chipdb_file_s = (std::string("+/share/arachne-pnr/chipdb-")
-                     + device
-                     + ".bin");
+        chipdb_file_s = (std::string("+/share/arachne-pnr/chipdb-")
+                         + device
+                         + ".bin");
 #endif
-  *logs << "read_chipdb " << chipdb_file_s << "...\n";
-  const ChipDB *chipdb = read_chipdb(chipdb_file_s);
+      *logs << "read_chipdb " << chipdb_file_s << "...\n";
+      chipdb = read_chipdb(chipdb_file_s,
+                           cache_dir ? cache_dir : std::string());
+    }
 
   if (binary_chipdb)
     {
@@ -500,9 +709,21 @@ main(int argc, const char **argv)
         for (Instance *inst : ds.top->instances())
           {
             const std::string &loc_attr = inst->get_attr("loc").as_string();
-            int cell;
-            if (sscanf(loc_attr.c_str(), "%d", &cell) != 1)
+            int cell, x, y, pos;
+            // x,y/pos as written by --post-place-blif, or a cell number
+            if (sscanf(loc_attr.c_str(), "%d,%d/%d", &x, &y, &pos) == 3)
+              {
+                if (x < 0 || x >= chipdb->width
+                    || y < 0 || y >= chipdb->height
+                    || pos < 0
+                    || pos >= (int)chipdb->tile_pos_cell[chipdb->tile(x, y)].size())
+                  fatal(fmt("invalid loc attribute `" << loc_attr << "'"));
+                cell = chipdb->loc_cell(Location(chipdb->tile(x, y), pos));
+              }
+            else if (sscanf(loc_attr.c_str(), "%d", &cell) != 1)
               fatal("parse error in loc attribute");
+            if (cell < 1 || cell > chipdb->n_cells)
+              fatal(fmt("invalid loc attribute `" << loc_attr << "'"));
             extend(ds.placement, inst, cell);
           }
       }
@@ -633,8 +854,38 @@ main(int argc, const char **argv)
 
     // d->dump();
 
+    std::ofstream route_stats_fs;
+    if (route_stats)
+      {
+        std::string expanded = expand_filename(route_stats);
+        route_stats_fs.open(expanded);
+        if (route_stats_fs.fail())
+          fatal(fmt("write_route_stats: failed to open `" << expanded << "': "
+                    << strerror(errno)));
+        route_stats_fs << "# " << version_str << "\n";
+        route_opts.stats = &route_stats_fs;
+      }
+    std::ofstream route_utilization_fs;
+    if (route_utilization)
+      {
+        std::string expanded = expand_filename(route_utilization);
+        route_utilization_fs.open(expanded);
+        if (route_utilization_fs.fail())
+          fatal(fmt("write_route_utilization: failed to open `" << expanded << "': "
+                    << strerror(errno)));
+        route_opts.utilization = &route_utilization_fs;
+      }
+
+    Configuration warm_start_conf(chipdb);
+    if (route_warm_start)
+      {
+        *logs << "read_txt " << route_warm_start << "...\n";
+        warm_start_conf.read_txt(route_warm_start);
+        route_opts.warm_start = &warm_start_conf;
+      }
+
     *logs << "route...\n";
-    route(ds, max_passes);
+    route(rg, ds, route_opts);
 #ifndef NDEBUG
     d->check();
 #endif
@@ -647,12 +898,12 @@ main(int argc, const char **argv)
         if (fs.fail())
           fatal(fmt("write_txt: failed to open `" << expanded << "': "
                     << strerror(errno)));
-        ds.conf.write_txt(fs, chipdb, d, ds.placement, ds.cnet_net);
+        ds.conf.write_txt(fs, d, ds.placement, ds.cnet_net);
       }
     else
       {
         *logs << "write_txt <stdout>...\n";
-        ds.conf.write_txt(std::cout, chipdb, d, ds.placement, ds.cnet_net);
+        ds.conf.write_txt(std::cout, d, ds.placement, ds.cnet_net);
       }
   }
 
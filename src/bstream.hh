@@ -31,10 +31,11 @@ class obstream
 {
 private:
   std::ostream &os;
+  size_t pos;
   
 public:
   obstream(std::ostream &os_)
-    : os(os_)
+    : os(os_), pos(0)
   {}
   
   void write(const char *p, size_t n)
@@ -43,6 +44,18 @@ public:
     if (os.bad())
       fatal(fmt("std::ostream::write: "
                 << strerror(errno)));
+    pos += n;
+  }
+  
+  // pad with zeros to a multiple of a bytes from the start of the
+  // stream
+  void align(size_t a)
+  {
+    static const char zeros[16] = {};
+    assert(a <= sizeof(zeros));
+    size_t r = pos % a;
+    if (r)
+      write(zeros, a - r);
   }
 };
 
@@ -202,23 +215,63 @@ operator<<(obstream &obs, const std::tuple<F, S, T> &t)
              << std::get<2>(t);
 }
 
+// Reads from a std::istream, or from a buffer in memory (e.g., a
+// mapped file) which must outlive anything read with in_place.
 class ibstream
 {
 private:
-  std::istream &is;
+  std::istream *is;
+  const char *buf, *buf_end;
+  size_t pos;
   
 public:
   ibstream(std::istream &is_)
-    : is(is_)
+    : is(&is_), buf(nullptr), buf_end(nullptr), pos(0)
+  {}
+  ibstream(const char *p, size_t n)
+    : is(nullptr), buf(p), buf_end(p + n), pos(0)
   {}
   
   void read(char *p, size_t n)
   {
-    is.read(p, n);
-    size_t rn = is.gcount();
-    if (is.bad()
-        || rn != n)
-      fatal(fmt("std::istream::read: " << strerror(errno)));
+    if (is)
+      {
+        is->read(p, n);
+        size_t rn = is->gcount();
+        if (is->bad()
+            || rn != n)
+          fatal(fmt("std::istream::read: " << strerror(errno)));
+      }
+    else
+      {
+        if (n > (size_t)(buf_end - (buf + pos)))
+          fatal("ibstream::read: unexpected end of data");
+        memcpy(p, buf + pos, n);
+      }
+    pos += n;
+  }
+  
+  // skip the padding written by obstream::align
+  void align(size_t a)
+  {
+    char pad[16];
+    assert(a <= sizeof(pad));
+    size_t r = pos % a;
+    if (r)
+      read(pad, a - r);
+  }
+  
+  // the next n bytes, without copying, if reading from memory; else
+  // nullptr
+  const char *in_place(size_t n)
+  {
+    if (is)
+      return nullptr;
+    if (n > (size_t)(buf_end - (buf + pos)))
+      fatal("ibstream::read: unexpected end of data");
+    const char *p = buf + pos;
+    pos += n;
+    return p;
   }
 };
  
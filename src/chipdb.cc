@@ -19,8 +19,30 @@
 
 #include <cassert>
 #include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <queue>
+#include <limits>
+#include <climits>
+#include <iterator>
+#include <algorithm>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#include <direct.h>
+#include <process.h>
+#endif
+
+const char *const chipdb_magic = "arachne-pnr binary chipdb";
 
 std::ostream &
 operator<<(std::ostream &s, const CBit &cbit)
@@ -103,44 +125,345 @@ tile_type_name(TileType t)
   return std::string();
 }
 
-obstream &operator<<(obstream &obs, const Switch &sw)
+obstream &operator<<(obstream &obs, const SwitchPattern &sp)
+{
+  return obs << sp.bidir
+             << sp.out
+             << sp.in_val
+             << sp.cbits;
+}
+
+ibstream &operator>>(ibstream &ibs, SwitchPattern &sp)
+{
+  return ibs >> sp.bidir
+             >> sp.out
+             >> sp.in_val
+             >> sp.cbits;
+}
+
+std::string
+span_type_name(SpanType st)
+{
+  switch(st)
+    {
+    case SpanType::OTHER:
+      return "other";
+    case SpanType::LOCAL:
+      return "local";
+    case SpanType::SPAN4:
+      return "span4";
+    case SpanType::SPAN12:
+      return "span12";
+    case SpanType::GLOBAL:
+      return "global";
+    }
+  abort();
+}
+
+int
+span_type_delay(SpanType st)
+{
+  switch(st)
+    {
+    case SpanType::OTHER:
+      return 260;  // InMux, neighbour, cell pins
+    case SpanType::LOCAL:
+      return 330;
+    case SpanType::SPAN4:
+      return 350;
+    case SpanType::SPAN12:
+      return 450;
+    case SpanType::GLOBAL:
+      return 150;
+    }
+  abort();
+}
+
+static SpanType
+net_name_span_type(const std::string &name)
+{
+  if (is_prefix("local_", name))
+    return SpanType::LOCAL;
+  else if (is_prefix("span4_", name)
+           || is_prefix("sp4_", name))
+    return SpanType::SPAN4;
+  else if (is_prefix("span12_", name)
+           || is_prefix("sp12_", name))
+    return SpanType::SPAN12;
+  else if (is_prefix("glb_netwk_", name))
+    return SpanType::GLOBAL;
+  else
+    return SpanType::OTHER;
+}
+
+void
+RoutingGraph::build(const ChipDB *chipdb)
 {
-  obs << sw.bidir
-      << sw.tile
-      << sw.out
-      << sw.cbits.size();
-  for (const CBit &cbit : sw.cbits)
+  int n = chipdb->n_nets;
+  
+  std::vector<int> base_cost(n, 1);
+  std::vector<SpanType> span_type(n, SpanType::OTHER);
+  std::vector<int> tile(n, -1);
+  const SymbolTable &net_names = chipdb->net_names();
+  for (int t = 0; t < chipdb->n_tiles; ++t)
+    for (const auto &p : chipdb->tile_nets()[t])
+      {
+        int i = p.second;
+        if (tile[i] < 0)
+          tile[i] = t;
+        if (span_type[i] == SpanType::OTHER)
+          span_type[i] = net_name_span_type(net_names.name(p.first));
+      }
+  
+  std::vector<int> delay(n);
+  for (int i = 0; i < n; ++i)
+    delay[i] = span_type_delay(span_type[i]);
+  
+  // switches by input net, in switch order
+  std::vector<int> obegin(n + 1, 0);
+  for (int t = 0; t < chipdb->n_tiles; ++t)
     {
-      assert(cbit.tile == sw.tile);
-      obs << cbit.row << cbit.col;
+      const std::vector<int> &nets = chipdb->tile_switch_nets()[t];
+      for (const SwitchPattern &sp : chipdb->tile_switches(t))
+        for (const auto &p : sp.in_val)
+          ++obegin[nets[p.first] + 1];
     }
-  obs << sw.in_val;
-  return obs;
+  for (int i = 0; i < n; ++i)
+    obegin[i + 1] += obegin[i];
+  std::vector<int> onet(obegin[n]),
+    oswitch(obegin[n]);
+  std::vector<unsigned> oval(obegin[n]);
+  std::vector<int> ofill(obegin.begin(), obegin.end() - 1);
+  int s = 0;
+  for (int t = 0; t < chipdb->n_tiles; ++t)
+    {
+      const std::vector<int> &nets = chipdb->tile_switch_nets()[t];
+      for (const SwitchPattern &sp : chipdb->tile_switches(t))
+        {
+          int out = nets[sp.out];
+          for (const auto &p : sp.in_val)
+            {
+              int i = nets[p.first];
+              assert(i != out);
+              int e = ofill[i]++;
+              onet[e] = out;
+              oswitch[e] = s;
+              oval[e] = p.second;
+            }
+          ++s;
+        }
+    }
+  
+  std::vector<int> ibegin(n + 1, 0);
+  for (int j : onet)
+    ++ibegin[j + 1];
+  for (int i = 0; i < n; ++i)
+    ibegin[i + 1] += ibegin[i];
+  std::vector<int> inet(onet.size()),
+    iswitch(onet.size());
+  std::vector<unsigned> iswitch_val(onet.size());
+  std::vector<int> fill(ibegin.begin(), ibegin.end() - 1);
+  for (int i = 0; i < n; ++i)
+    for (int oe = obegin[i]; oe < obegin[i + 1]; ++oe)
+      {
+        int e = fill[onet[oe]]++;
+        inet[e] = i;
+        iswitch[e] = oswitch[oe];
+        iswitch_val[e] = oval[oe];
+      }
+  
+  out_begin = std::move(obegin);
+  out_net = std::move(onet);
+  in_begin = std::move(ibegin);
+  in_net = std::move(inet);
+  in_switch = std::move(iswitch);
+  in_switch_val = std::move(iswitch_val);
+  net_base_cost = std::move(base_cost);
+  net_span_type = std::move(span_type);
+  net_delay = std::move(delay);
+  net_tile = std::move(tile);
+  
+  build_lookahead(chipdb);
 }
 
-ibstream &operator>>(ibstream &ibs, Switch &sw)
+// The lookahead is sampled, so a wire the samples miss can do better
+// than the table says, and the router's A* search is then no longer
+// guaranteed to find the cheapest route.  Scaling the sampled costs
+// down by lookahead_scale_percent keeps such overestimates rare.
+static const int lookahead_scale_percent = 75;
+
+void
+RoutingGraph::build_lookahead(const ChipDB *chipdb)
 {
-  size_t n_cbits;
-  ibs >> sw.bidir
-      >> sw.tile
-      >> sw.out
-      >> n_cbits;
-  sw.cbits.resize(n_cbits);
-  for (size_t i = 0; i < n_cbits; ++i)
+  static const int n_span_types = static_cast<int>(SpanType::GLOBAL) + 1;
+  const int inf = std::numeric_limits<int>::max();
+  
+  int n = n_nets();
+  width = chipdb->width;
+  height = chipdb->height;
+  std::vector<int> la(n_span_types * width * height, inf);
+  
+  // offsets are measured from the bounding box of the tiles a net
+  // spans, as the router does
+  std::vector<int> xmin(n, width), xmax(n, -1),
+    ymin(n, height), ymax(n, -1);
+  for (int t = 0; t < chipdb->n_tiles; ++t)
     {
-      int row, col;
-      ibs >> row >> col;
-      sw.cbits[i] = CBit(sw.tile, row, col);
+      int x = chipdb->tile_x(t),
+        y = chipdb->tile_y(t);
+      for (const auto &p : chipdb->tile_nets()[t])
+        {
+          int i = p.second;
+          xmin[i] = std::min(xmin[i], x);
+          xmax[i] = std::max(xmax[i], x);
+          ymin[i] = std::min(ymin[i], y);
+          ymax[i] = std::max(ymax[i], y);
+        }
     }
-  ibs >> sw.in_val;
-  return ibs;
+  
+  // Search from the few nets of each type nearest the middle and the
+  // corners of the chip, so every offset is seen from somewhere.
+  const std::pair<int, int> points[] = {
+    {width / 2, height / 2},
+    {1, 1}, {width - 2, 1}, {1, height - 2}, {width - 2, height - 2},
+  };
+  const int n_samples = 4;
+  
+  std::vector<int> dist(n, inf);
+  std::vector<int> touched;
+  std::priority_queue<std::pair<int, int>,
+                      std::vector<std::pair<int, int>>,
+                      std::greater<std::pair<int, int>>> q;  // dist, net
+  for (int k = 0; k < n_span_types; ++k)
+    for (const auto &pt : points)
+      {
+        std::vector<std::pair<int, int>> nearest;  // distance, net
+        for (int i = 0; i < n; ++i)
+          {
+            if (static_cast<int>(net_span_type[i]) == k
+                && out_begin[i] < out_begin[i + 1])
+              {
+                int dx = std::max(0, std::max(xmin[i] - pt.first,
+                                              pt.first - xmax[i])),
+                  dy = std::max(0, std::max(ymin[i] - pt.second,
+                                            pt.second - ymax[i]));
+                nearest.push_back(std::make_pair(dx + dy, i));
+              }
+          }
+        int m = std::min(n_samples, (int)nearest.size());
+        std::partial_sort(nearest.begin(), nearest.begin() + m, nearest.end());
+        
+        for (int j = 0; j < m; ++j)
+          {
+            int s = nearest[j].second;
+            for (int i : touched)
+              dist[i] = inf;
+            touched.clear();
+            
+            dist[s] = 0;
+            touched.push_back(s);
+            q.push(std::make_pair(0, s));
+            while (!q.empty())
+              {
+                int d = q.top().first,
+                  i = q.top().second;
+                q.pop();
+                if (d > dist[i])
+                  continue;
+                
+                if (out_begin[i] == out_begin[i + 1])
+                  {
+                    int dx = std::max(0, std::max(xmin[i] - xmax[s],
+                                                  xmin[s] - xmax[i])),
+                      dy = std::max(0, std::max(ymin[i] - ymax[s],
+                                                ymin[s] - ymax[i]));
+                    int &c = la[(k * height + dy) * width + dx];
+                    c = std::min(c, d);
+                    continue;
+                  }
+                
+                for (int e = out_begin[i]; e < out_begin[i + 1]; ++e)
+                  {
+                    int i2 = out_net[e];
+                    int d2 = d + net_base_cost[i2];
+                    if (d2 < dist[i2])
+                      {
+                        if (dist[i2] == inf)
+                          touched.push_back(i2);
+                        dist[i2] = d2;
+                        q.push(std::make_pair(d2, i2));
+                      }
+                  }
+              }
+          }
+      }
+  
+  // "at least dx, dy away": take the minimum over all further
+  // offsets.  Offsets never reached get no estimate.
+  for (int k = 0; k < n_span_types; ++k)
+    for (int dy = height - 1; dy >= 0; --dy)
+      for (int dx = width - 1; dx >= 0; --dx)
+        {
+          int &c = la[(k * height + dy) * width + dx];
+          if (dx + 1 < width)
+            c = std::min(c, la[(k * height + dy) * width + dx + 1]);
+          if (dy + 1 < height)
+            c = std::min(c, la[(k * height + dy + 1) * width + dx]);
+        }
+  for (int &c : la)
+    {
+      if (c == inf)
+        c = 0;
+      else
+        c = c * lookahead_scale_percent / 100;
+    }
+  lookahead = std::move(la);
+}
+
+obstream &operator<<(obstream &obs, const RoutingGraph &g)
+{
+  return obs << g.out_begin
+             << g.out_net
+             << g.in_begin
+             << g.in_net
+             << g.in_switch
+             << g.in_switch_val
+             << g.net_base_cost
+             << g.net_span_type
+             << g.net_delay
+             << g.net_tile
+             << g.width
+             << g.height
+             << g.lookahead;
+}
+
+ibstream &operator>>(ibstream &ibs, RoutingGraph &g)
+{
+  return ibs >> g.out_begin
+             >> g.out_net
+             >> g.in_begin
+             >> g.in_net
+             >> g.in_switch
+             >> g.in_switch_val
+             >> g.net_base_cost
+             >> g.net_span_type
+             >> g.net_delay
+             >> g.net_tile
+             >> g.width
+             >> g.height
+             >> g.lookahead;
 }
 
 ChipDB::ChipDB()
   : width(0), height(0), n_tiles(0), n_nets(0), n_global_nets(8),
     n_cells(0),
     cell_type_cells(n_cell_types),
-    bank_cells(4)
+    bank_cells(4),
+    m_tile_switch_begin(1, 0),
+    section_base(nullptr),
+    tile_nets_loaded(false),
+    switches_loaded(false),
+    routing_graph_loaded(false)
 {
 }
 
@@ -176,6 +499,9 @@ ChipDB::tile_bank(int t) const
 void
 ChipDB::dump(std::ostream &s) const
 {
+  load_tile_nets();
+  load_switches();
+  
   s << ".device " << device << "\n\n";
   
   for (const auto &p : packages)
@@ -193,9 +519,13 @@ ChipDB::dump(std::ostream &s) const
     }
   
   s << ".colbuf\n";
-  for (const auto &p : tile_colbuf_tile)
-    s << tile_x(p.second) << " " << tile_y(p.second) << " "
-      << tile_x(p.first) << " " << tile_y(p.first) << "\n";
+  for (int t = 0; t < n_tiles; ++t)
+    {
+      int cb_t = tile_colbuf_tile[t];
+      if (cb_t >= 0)
+        s << tile_x(cb_t) << " " << tile_y(cb_t) << " "
+          << tile_x(t) << " " << tile_y(t) << "\n";
+    }
   s << "\n";
   
   for (int i = 0; i < width; i ++)
@@ -235,10 +565,13 @@ ChipDB::dump(std::ostream &s) const
             break;
           }
         
-        for (const auto &p : tile_nonrouting_cbits.at(tile_type[t]))
+        const auto &func_cbits = tile_func_cbits.at(tile_type[t]);
+        for (int f = 0; f < func_names.size(); ++f)
           {
-            s << p.first;
-            for (const auto &cbit : p.second)
+            if (func_cbits[f].empty())
+              continue;
+            s << func_names.name(f);
+            for (const auto &cbit : func_cbits[f])
               s << " " << cbit;
             s << "\n";
           }
@@ -247,8 +580,8 @@ ChipDB::dump(std::ostream &s) const
   
   std::vector<std::vector<std::pair<int, std::string>>> net_tile_names(n_nets);
   for (int i = 0; i < n_tiles; ++i)
-    for (const auto &p : tile_nets[i])
-      net_tile_names[p.second].push_back(std::make_pair(i, p.first));
+    for (const auto &p : m_tile_nets[i])
+      net_tile_names[p.second].push_back(std::make_pair(i, m_net_names.name(p.first)));
   
   for (int i = 0; i < n_nets; ++i)
     {
@@ -258,9 +591,9 @@ ChipDB::dump(std::ostream &s) const
       s << "\n";
     }
   
-  for (unsigned i = 0; i < switches.size(); ++i)
+  for (int i = 0; i < n_switches(); ++i)
     {
-      const Switch &sw = switches[i];
+      Switch sw = get_switch(i);
       
       s << (sw.bidir ? ".routing" : ".buffer")
         << " " << tile_x(sw.tile) << " " << tile_y(sw.tile) << " " << sw.out;
@@ -295,17 +628,44 @@ ChipDB::set_device(const std::string &d,
   n_nets = n_nets_;
   
   tile_type.resize(n_tiles, TileType::EMPTY);
-  tile_nets.resize(n_tiles);
+  tile_colbuf_tile.resize(n_tiles, -1);
+  m_tile_nets.resize(n_tiles);
   
-  net_tile_name.resize(n_nets);
-  out_switches.resize(n_nets);
-  in_switches.resize(n_nets);
+  m_net_tile_name.resize(n_nets);
 }
 
+// An istream over a block of memory.
+class MemoryBuf : public std::streambuf
+{
+public:
+  MemoryBuf(const char *begin, const char *end)
+  {
+    char *p = const_cast<char *>(begin);
+    setg(p, p, p + (end - begin));
+  }
+};
+
+// A text chipdb is split into blocks at directives.  The .net,
+// .buffer and .routing blocks, nearly all of the file, are parsed in
+// parallel into per-thread buffers and merged in file order; the
+// others are parsed in order first, as .device must precede them.
 class ChipDBParser : public LineParser
 {
   ChipDB *chipdb;
   
+  // .net entries in file order
+  class NetEntry
+  {
+  public:
+    int net;
+    int tile;
+    std::string name;
+    bool first; // of its .net block
+  };
+  std::vector<NetEntry> net_entries;
+  std::vector<Switch> switches;
+  std::map<TileType, std::map<std::string, std::vector<CBit>>> *func_cbits;
+  
   CBit parse_cbit(int tile, const std::string &s);
   
   void parse_cmd_device();
@@ -322,12 +682,22 @@ class ChipDBParser : public LineParser
   void parse_cmd_extra_bits();
   void parse_cmd_extra_cell();
   
-public:
-  ChipDBParser(const std::string &f, std::istream &s_)
-    : LineParser(f, s_), chipdb(nullptr)
+  static bool is_routing_cmd(const std::string &cmd)
+  {
+    return cmd == ".net" || cmd == ".buffer" || cmd == ".routing";
+  }
+  
+  ChipDBParser(const std::string &f, std::istream &s_, int first_line,
+               ChipDB *chipdb_,
+               std::map<TileType, std::map<std::string, std::vector<CBit>>> *func_cbits_)
+    : LineParser(f, s_, first_line), chipdb(chipdb_), func_cbits(func_cbits_)
   {}
   
-  ChipDB *parse();
+  void parse_directives(bool routing);
+  
+public:
+  static ChipDB *parse(const std::string &f, const char *text, size_t size,
+                       int n_threads);
 };
 
 CBit
@@ -535,7 +905,7 @@ ChipDBParser::parse_cmd_tile_bits()
       for (unsigned i = 1; i < words.size(); ++i)
         cbits[i - 1] = parse_cbit(0, words[i]);
       
-      extend(chipdb->tile_nonrouting_cbits[ty], func, cbits);
+      extend((*func_cbits)[ty], func, cbits);
     }
 
 }
@@ -569,12 +939,8 @@ ChipDBParser::parse_cmd_net()
         fatal("tile y out of range");
       int t = chipdb->tile(x, y);
       
-      if (first)
-        {
-          chipdb->net_tile_name[n] = std::make_pair(t, words[2]);
-          first = false;
-        }
-      extend(chipdb->tile_nets[t], words[2], n);
+      net_entries.push_back(NetEntry{n, t, words[2], first});
+      first = false;
     }
 }
 
@@ -610,11 +976,11 @@ ChipDBParser::parse_cmd_buffer_routing()
       if (eof()
           || line[0] == '.')
         {
-          chipdb->switches.push_back(Switch(bidir,
-                                            t,
-                                            n,
-                                            in_val,
-                                            cbits));
+          switches.push_back(Switch(bidir,
+                                    t,
+                                    n,
+                                    in_val,
+                                    cbits));
           return;
         }
       
@@ -826,11 +1192,11 @@ ChipDBParser::parse_cmd_extra_cell()
     }
 }
 
-ChipDB *
-ChipDBParser::parse()
+// Parse the directives of the stream that are (routing) or are not
+// (!routing) .net/.buffer/.routing, skipping the rest.
+void
+ChipDBParser::parse_directives(bool routing)
 {
-  chipdb = new ChipDB;
-  
   read_line();
   for (;;)
     {
@@ -840,7 +1206,14 @@ ChipDBParser::parse()
         fatal(fmt("expected command, got '" << words[0] << "'"));
       
       const std::string &cmd = words[0];
-      if (cmd == ".device")
+      if (is_routing_cmd(cmd) != routing)
+        {
+          do
+            read_line();
+          while (!eof()
+                 && line[0] != '.');
+        }
+      else if (cmd == ".device")
         parse_cmd_device();
       else if (cmd == ".pins")
         parse_cmd_pins();
@@ -886,7 +1259,144 @@ ChipDBParser::parse()
       else
         fatal(fmt("unknown directive '" << cmd << "'"));
     }
+}
+
+ChipDB *
+ChipDBParser::parse(const std::string &f, const char *text, size_t size,
+                    int n_threads)
+{
+  const char *end = text + size;
+  
+  // blocks start at lines beginning with `.'; the first also takes
+  // anything before the first directive
+  std::vector<const char *> block_begin;
+  std::vector<int> block_line;
+  std::vector<bool> block_routing;
+  int n_line = 1;
+  for (const char *p = text; p < end; )
+    {
+      if (p == text || *p == '.')
+        {
+          const char *q = p;
+          while (q < end && !isspace(*q))
+            ++q;
+          block_begin.push_back(p);
+          block_line.push_back(n_line);
+          block_routing.push_back(is_routing_cmd(std::string(p, q)));
+        }
+      const char *nl = static_cast<const char *>(memchr(p, '\n', end - p));
+      if (!nl)
+        break;
+      p = nl + 1;
+      ++n_line;
+    }
+  int n_blocks = block_begin.size();
+  block_begin.push_back(end);
+  
+  ChipDB *chipdb = new ChipDB;
+  std::map<TileType, std::map<std::string, std::vector<CBit>>> func_cbits;
+  
+  // runs of non-routing blocks, in order
+  for (int i = 0; i < n_blocks; )
+    {
+      if (block_routing[i])
+        {
+          ++i;
+          continue;
+        }
+      int j = i + 1;
+      while (j < n_blocks && !block_routing[j])
+        ++j;
+      MemoryBuf buf(block_begin[i], block_begin[j]);
+      std::istream is(&buf);
+      ChipDBParser parser(f, is, block_line[i], chipdb, &func_cbits);
+      parser.parse_directives(false);
+      i = j;
+    }
+  
+  // routing blocks, in byte-balanced chunks of consecutive blocks
+  if (n_threads <= 0)
+    n_threads = std::max(1u, std::min(std::thread::hardware_concurrency(), 16u));
+  std::vector<int> chunk_begin;
+  for (int i = 0, k = 0; i < n_blocks; ++i)
+    {
+      if ((size_t)(block_begin[i] - text) * n_threads >= (size_t)k * size)
+        {
+          chunk_begin.push_back(i);
+          ++k;
+        }
+    }
+  chunk_begin.push_back(n_blocks);
+  int n_chunks = chunk_begin.size() - 1;
   
+  std::vector<ChipDBParser *> parsers(n_chunks);
+  std::vector<MemoryBuf *> bufs(n_chunks);
+  std::vector<std::istream *> streams(n_chunks);
+  for (int k = 0; k < n_chunks; ++k)
+    {
+      bufs[k] = new MemoryBuf(block_begin[chunk_begin[k]],
+                              block_begin[chunk_begin[k + 1]]);
+      streams[k] = new std::istream(bufs[k]);
+      parsers[k] = new ChipDBParser(f, *streams[k],
+                                    block_line[chunk_begin[k]], chipdb,
+                                    nullptr);
+    }
+  
+  // a chunk's parser stops at its first error; once all are done,
+  // report the first error in file order
+  std::vector<LineParser::Error *> errors(n_chunks, nullptr);
+  auto parse_chunk = [&parsers, &errors](int k) {
+    parsers[k]->throw_errors = true;
+    try
+      {
+        parsers[k]->parse_directives(true);
+      }
+    catch (const LineParser::Error &e)
+      {
+        errors[k] = new LineParser::Error(e);
+      }
+  };
+  
+  std::vector<std::thread> threads;
+  for (int k = 1; k < n_chunks; ++k)
+    threads.push_back(std::thread(parse_chunk, k));
+  if (n_chunks > 0)
+    parse_chunk(0);
+  for (std::thread &t : threads)
+    t.join();
+  for (int k = 0; k < n_chunks; ++k)
+    {
+      if (errors[k])
+        errors[k]->fatal();
+    }
+  
+  std::vector<std::string> names;
+  for (int k = 0; k < n_chunks; ++k)
+    for (const NetEntry &e : parsers[k]->net_entries)
+      names.push_back(e.name);
+  chipdb->m_net_names = SymbolTable(std::move(names));
+  
+  std::vector<Switch> switches;
+  for (int k = 0; k < n_chunks; ++k)
+    {
+      for (const NetEntry &e : parsers[k]->net_entries)
+        {
+          if (e.first)
+            chipdb->m_net_tile_name[e.net] = std::make_pair(e.tile, e.name);
+          chipdb->m_tile_nets[e.tile].push_back(std::make_pair(chipdb->m_net_names.id(e.name),
+                                                             e.net));
+        }
+      switches.insert(switches.end(),
+                      std::make_move_iterator(parsers[k]->switches.begin()),
+                      std::make_move_iterator(parsers[k]->switches.end()));
+      
+      delete parsers[k];
+      delete streams[k];
+      delete bufs[k];
+    }
+  
+  chipdb->set_func_cbits(func_cbits);
+  chipdb->set_switches(switches);
   chipdb->finalize();
   return chipdb;
 }
@@ -894,15 +1404,10 @@ ChipDBParser::parse()
 void
 ChipDB::finalize()
 {
-  int t1c1 = tile(1, 1);
-  for (const auto &p : tile_nets[t1c1])
-    {
-      if (is_prefix("glb_netwk_", p.first))
-        {
-          int n = std::stoi(&p.first[10]);
-          extend(net_global, p.second, n);
-        }
-    }
+  // may be called again, e.g. to time it
+  for (auto &v : bank_cells)
+    v.clear();
+  tile_pos_cell.clear();
   
   for (int i = 1; i <= n_cells; ++i)
     {
@@ -950,94 +1455,504 @@ ChipDB::finalize()
       tile_pos_cell[t][pos] = i;
     }
   
-  in_switches.resize(n_nets);
-  out_switches.resize(n_nets);
-  for (size_t s = 0;  s < switches.size(); ++s)
+  if (!section_base)
     {
-      int out = switches[s].out;
-      extend(out_switches[out], s);
-      for (const auto &p : switches[s].in_val)
-        extend(in_switches[p.first], s);
+      // text chipdb: everything is already read.  The routing graph
+      // (and its lookahead, which takes a while) is built on first
+      // use, typically to route or to write a binary chipdb.
+      tile_nets_loaded = true;
+      switches_loaded = true;
+      
+      for (int t = 0; t < n_tiles; ++t)
+        {
+          auto &v = m_tile_nets[t];
+          std::sort(v.begin(), v.end());
+          for (size_t i = 1; i < v.size(); ++i)
+            if (v[i].first == v[i - 1].first)
+              fatal(fmt("duplicate net `" << m_net_names.name(v[i].first) << "' in tile "
+                        << tile_x(t) << " " << tile_y(t)));
+        }
+      
+      finalize_tile_nets();
     }
 }
 
+void
+ChipDB::finalize_tile_nets() const
+{
+  m_net_global.clear();
+  m_net_global.resize(n_nets, -1);
+  int t1c1 = tile(1, 1);
+  for (const auto &p : m_tile_nets[t1c1])
+    {
+      const std::string &name = m_net_names.name(p.first);
+      if (is_prefix("glb_netwk_", name))
+        {
+          int n = std::stoi(&name[10]);
+          assert(m_net_global[p.second] < 0);
+          m_net_global[p.second] = n;
+        }
+    }
+  
+  build_cell_port_net();
+}
+
+const SwitchTemplate &
+ChipDB::tile_switches(int t) const
+{
+  static const SwitchTemplate no_switches;
+  load_switches();
+  int st = m_tile_switch_template[t];
+  return st >= 0 ? m_switch_templates[st] : no_switches;
+}
+
 int
-ChipDB::find_switch(int in, int out) const
+ChipDB::switch_tile(int s) const
 {
-  std::vector<int> t;
-  std::set_intersection(out_switches[out].begin(),
-                        out_switches[out].end(),
-                        in_switches[in].begin(),
-                        in_switches[in].end(),
-                        std::back_insert_iterator<std::vector<int>>(t));
-  assert(t.size() == 1);
-  int s = t[0];
-  assert(switches[s].out == out);
-  assert(contains_key(switches[s].in_val, in));
-  return s;
+  load_switches();
+  assert(s >= 0 && s < n_switches());
+  return (std::upper_bound(m_tile_switch_begin.begin(), m_tile_switch_begin.end(), s)
+          - m_tile_switch_begin.begin() - 1);
+}
+
+Switch
+ChipDB::get_switch(int s) const
+{
+  int t = switch_tile(s);
+  const SwitchPattern &sp = tile_switches(t)[s - m_tile_switch_begin[t]];
+  const std::vector<int> &nets = m_tile_switch_nets[t];
+  
+  std::map<int, unsigned> in_val;
+  for (const auto &p : sp.in_val)
+    extend(in_val, nets[p.first], p.second);
+  std::vector<CBit> cbits;
+  for (const auto &p : sp.cbits)
+    cbits.push_back(CBit(t, p.first, p.second));
+  return Switch(sp.bidir, t, nets[sp.out], in_val, cbits);
+}
+
+int
+ChipDB::switch_out(int s) const
+{
+  int t = switch_tile(s);
+  const SwitchPattern &sp = tile_switches(t)[s - m_tile_switch_begin[t]];
+  return m_tile_switch_nets[t][sp.out];
+}
+
+SwitchSetting
+ChipDB::switch_setting(int s, int in) const
+{
+  int t = switch_tile(s);
+  const SwitchPattern &sp = tile_switches(t)[s - m_tile_switch_begin[t]];
+  const std::vector<int> &nets = m_tile_switch_nets[t];
+  for (const auto &p : sp.in_val)
+    {
+      if (nets[p.first] == in)
+        return SwitchSetting{t, &sp.cbits, p.second};
+    }
+  abort();
 }
 
 void
-ChipDB::bwrite(obstream &obs) const
+ChipDB::set_switches(const std::vector<Switch> &switches)
 {
-  std::vector<std::string> net_names;
-  std::map<std::string, int> net_name_idx;
+  std::vector<std::vector<int>> tile_sw(n_tiles);
+  for (int s = 0; s < (int)switches.size(); ++s)
+    tile_sw[switches[s].tile].push_back(s);
   
-  std::vector<std::map<int, int>> tile_nets_idx(n_tiles);
+  std::map<SwitchTemplate, int> template_idx;
+  m_switch_templates.clear();
+  m_tile_switch_template.assign(n_tiles, -1);
+  m_tile_switch_begin.assign(n_tiles + 1, 0);
+  m_tile_switch_nets.assign(n_tiles, std::vector<int>());
   for (int t = 0; t < n_tiles; ++t)
     {
-      for (const auto &p : tile_nets[t])
+      m_tile_switch_begin[t + 1] = m_tile_switch_begin[t] + tile_sw[t].size();
+      if (tile_sw[t].empty())
+        continue;
+      
+      // slots in order of first use
+      std::vector<int> &nets = m_tile_switch_nets[t];
+      std::map<int, int> net_slot;
+      auto slot = [&](int n) -> int {
+        auto i = net_slot.find(n);
+        if (i != net_slot.end())
+          return i->second;
+        int k = nets.size();
+        nets.push_back(n);
+        net_slot.insert(std::make_pair(n, k));
+        return k;
+      };
+      
+      SwitchTemplate st;
+      for (int s : tile_sw[t])
         {
-          int ni;
-          auto i = net_name_idx.find(p.first);
-          if (i == net_name_idx.end())
+          const Switch &sw = switches[s];
+          SwitchPattern sp;
+          sp.bidir = sw.bidir;
+          sp.out = slot(sw.out);
+          for (const auto &p : sw.in_val)
+            sp.in_val.push_back(std::make_pair(slot(p.first), p.second));
+          for (const CBit &cbit : sw.cbits)
             {
-              ni = net_name_idx.size();
-              net_names.push_back(p.first);
-              net_name_idx.insert(std::make_pair(p.first, ni));
+              assert(cbit.tile == t);
+              sp.cbits.push_back(std::make_pair(cbit.row, cbit.col));
             }
-          else
-            ni = i->second;
-          extend(tile_nets_idx[t], ni, p.second);
+          st.push_back(sp);
+        }
+      
+      auto i = template_idx.find(st);
+      if (i == template_idx.end())
+        {
+          i = template_idx.insert(std::make_pair(st, (int)m_switch_templates.size())).first;
+          m_switch_templates.push_back(st);
         }
+      m_tile_switch_template[t] = i->second;
+    }
+}
+
+SymbolTable::SymbolTable(std::vector<std::string> names_)
+  : names(std::move(names_))
+{
+  std::sort(names.begin(), names.end());
+  names.erase(std::unique(names.begin(), names.end()), names.end());
+}
+
+int
+SymbolTable::id(const std::string &name) const
+{
+  auto i = std::lower_bound(names.begin(), names.end(), name);
+  if (i != names.end()
+      && *i == name)
+    return i - names.begin();
+  return -1;
+}
+
+int
+ChipDB::tile_net(int t, int name) const
+{
+  load_tile_nets();
+  const auto &v = m_tile_nets[t];
+  auto i = std::lower_bound(v.begin(), v.end(), std::make_pair(name, INT_MIN));
+  if (i != v.end()
+      && i->first == name)
+    return i->second;
+  return -1;
+}
+
+int
+ChipDB::tile_net(int t, const std::string &name) const
+{
+  int i = net_names().id(name);
+  return i >= 0 ? tile_net(t, i) : -1;
+}
+
+FuncCBits
+ChipDB::func_cbits(TileType ty) const
+{
+  return FuncCBits(&func_names, &tile_func_cbits.at(ty));
+}
+
+void
+ChipDB::set_func_cbits(const std::map<TileType,
+                                      std::map<std::string, std::vector<CBit>>> &m)
+{
+  std::vector<std::string> names;
+  for (const auto &p : m)
+    for (const auto &q : p.second)
+      names.push_back(q.first);
+  func_names = SymbolTable(std::move(names));
+  
+  tile_func_cbits.clear();
+  for (const auto &p : m)
+    {
+      std::vector<std::vector<CBit>> &v = tile_func_cbits[p.first];
+      v.resize(func_names.size());
+      for (const auto &q : p.second)
+        v[func_names.id(q.first)] = q.second;
+    }
+}
+
+ibstream
+ChipDB::section(const std::string &name) const
+{
+  auto i = sections.find(name);
+  if (i == sections.end())
+    fatal(fmt("binary chipdb has no `" << name << "' section"));
+  return ibstream(section_base + i->second.first, i->second.second);
+}
+
+void
+ChipDB::load_tile_nets() const
+{
+  if (tile_nets_loaded)
+    return;
+  tile_nets_loaded = true;
+  
+  ibstream ibs = section("tile_nets");
+  ibs >> m_net_names
+      >> m_tile_nets;
+  m_tile_nets.resize(n_tiles);
+  
+  finalize_tile_nets();
+}
+
+void
+ChipDB::load_switches() const
+{
+  if (switches_loaded)
+    return;
+  switches_loaded = true;
+  
+  ibstream ibs = section("switches");
+  ibs >> m_switch_templates
+      >> m_tile_switch_template
+      >> m_tile_switch_nets;
+  
+  m_tile_switch_begin.resize(n_tiles + 1);
+  m_tile_switch_begin[0] = 0;
+  for (int t = 0; t < n_tiles; ++t)
+    m_tile_switch_begin[t + 1] = m_tile_switch_begin[t] + tile_switches(t).size();
+}
+
+void
+ChipDB::load_routing_graph() const
+{
+  if (routing_graph_loaded)
+    return;
+  routing_graph_loaded = true;
+  
+  if (!section_base)
+    {
+      m_routing_graph.build(this);
+      return;
     }
+  
+  ibstream ibs = section("routing_graph");
+  ibs >> m_routing_graph;
+}
+
+const std::vector<std::string> &
+cell_type_ports(CellType type)
+{
+  static const std::vector<std::string> lc_ports = {
+    "CLK", "CEN", "SR", "I0", "I1", "I2", "I3", "CIN", "COUT", "LO", "O",
+  };
+  static const std::vector<std::string> io_ports = {
+    "LATCH_INPUT_VALUE", "CLOCK_ENABLE", "INPUT_CLK", "OUTPUT_CLK",
+    "OUTPUT_ENABLE", "D_OUT_0", "D_OUT_1", "D_IN_0", "D_IN_1",
+    "PU_ENB", "WEAK_PU_ENB", "GLOBAL_BUFFER_OUTPUT",
+  };
+  static const std::vector<std::string> gb_ports = {
+    "USER_SIGNAL_TO_GLOBAL_BUFFER", "GLOBAL_BUFFER_OUTPUT",
+  };
+  static const std::vector<std::string> no_ports;
+  
+  switch(type)
+    {
+    case CellType::LOGIC:
+      return lc_ports;
+    case CellType::IO:
+      return io_ports;
+    case CellType::GB:
+      return gb_ports;
+    default:
+      return no_ports;
+    }
+}
 
-  obs << std::string(version_str)
-      << device
-      << width
-      << height
+void
+ChipDB::build_cell_port_net() const
+{
+  m_cell_port_net.clear();
+  m_cell_port_net.resize(n_cells);
+  
+  for (int c = 1; c <= n_cells; ++c)
+    {
+      const Location &loc = cell_location[c];
+      int t = loc.tile();
+      int pos = loc.pos();
+      std::vector<int> &port_net = m_cell_port_net[c];
+      switch(cell_type[c])
+        {
+        case CellType::LOGIC:
+          {
+            std::string lutff = fmt("lutff_" << pos << "/");
+            port_net = {
+              tile_net(t, "lutff_global/clk"),
+              tile_net(t, "lutff_global/cen"),
+              tile_net(t, "lutff_global/s_r"),
+              tile_net(t, lutff + "in_0"),
+              tile_net(t, lutff + "in_1"),
+              tile_net(t, lutff + "in_2"),
+              tile_net(t, lutff + "in_3"),
+              pos == 0 ? tile_net(t, "carry_in_mux") : -1,
+              tile_net(t, lutff + "cout"),
+              tile_net(t, lutff + "lout"),
+              tile_net(t, lutff + "out"),
+            };
+          }
+          break;
+        case CellType::IO:
+          {
+            std::string io = fmt("io_" << pos << "/");
+            int g = lookup_or_default(loc_pin_glb_num, loc, -1);
+            port_net = {
+              tile_net(t, "io_global/latch"),
+              tile_net(t, "io_global/cen"),
+              tile_net(t, "io_global/inclk"),
+              tile_net(t, "io_global/outclk"),
+              tile_net(t, io + "OUT_ENB"),
+              tile_net(t, io + "D_OUT_0"),
+              tile_net(t, io + "D_OUT_1"),
+              tile_net(t, io + "D_IN_0"),
+              tile_net(t, io + "D_IN_1"),
+              -1,
+              -1,
+              g >= 0 ? tile_net(t, fmt("glb_netwk_" << g)) : -1,
+            };
+          }
+          break;
+        case CellType::GB:
+          {
+            auto i = gbufin.find(std::make_pair(tile_x(t), tile_y(t)));
+            port_net = {
+              tile_net(t, "fabout"),
+              (i != gbufin.end()
+               ? tile_net(t, fmt("glb_netwk_" << i->second))
+               : -1),
+            };
+          }
+          break;
+        default:
+          break;
+        }
+    }
+  
+  // I3C pull-up enables of the IO at the I3C cell's PACKAGE_PIN
+  for (int c : cell_type_cells[cell_type_idx(CellType::IO_I3C)])
+    {
+      const auto &mfvs = cell_mfvs.at(c);
+      const auto &pin = mfvs.at("PACKAGE_PIN");
+      int t = pin.first,
+        pos = std::stoi(pin.second);
+      if (pos >= (int)tile_pos_cell[t].size())
+        continue;
+      int io_cell = tile_pos_cell[t][pos];
+      if (!io_cell
+          || cell_type[io_cell] != CellType::IO)
+        continue;
+      
+      std::vector<int> &port_net = m_cell_port_net[io_cell];
+      for (int i : {9, 10})
+        {
+          auto j = mfvs.find(cell_type_ports(CellType::IO)[i]);
+          if (j != mfvs.end())
+            port_net[i] = tile_net(j->second.first, j->second.second);
+        }
+    }
+}
+
+int
+ChipDB::find_switch(int in, int out) const
+{
+  load_routing_graph();
+  int e = m_routing_graph.in_edge(in, out);
+  int s = m_routing_graph.in_switch[e];
+  assert(switch_out(s) == out);
+  assert(switch_setting(s, in).value == m_routing_graph.in_switch_val[e]);
+  return s;
+}
+
+void
+ChipDB::bwrite(obstream &obs) const
+{
+  load_tile_nets();
+  load_switches();
+  load_routing_graph();
+  
+  std::ostringstream core_s, tile_nets_s, switches_s, routing_graph_s;
+  
+  obstream core_obs(core_s);
+  core_obs << device
+           << width
+           << height
     // n_tiles = width * height
-      << n_nets
+           << n_nets
     // n_global_nets = 8
-      << packages
-      << loc_pin_glb_num
-      << iolatch
-      << ieren
-      << extra_bits
-      << gbufin
-      << tile_colbuf_tile
-      << tile_type
-    // net_tile_name
-      << net_names
-      << tile_nets_idx // tile_nets
-      << tile_nonrouting_cbits
-      << n_cells
-      << cell_type
-      << cell_location
-      << cell_mfvs
-      << cell_locked_pkgs
-      << cell_type_cells
+           << packages
+           << loc_pin_glb_num
+           << iolatch
+           << ieren
+           << extra_bits
+           << gbufin
+           << tile_colbuf_tile
+           << tile_type
+           << func_names
+           << tile_func_cbits
+           << n_cells
+           << cell_type
+           << cell_location
+           << cell_mfvs
+           << cell_locked_pkgs
+           << cell_type_cells
     // bank_cells
-      << switches
-    // in_switches, out_switches
-      << tile_cbits_block_size;
+           << tile_cbits_block_size;
+  
+  obstream tile_nets_obs(tile_nets_s);
+  tile_nets_obs << m_net_names
+    // net_tile_name
+                << m_tile_nets;
+  
+  obstream switches_obs(switches_s);
+  switches_obs << m_switch_templates
+               << m_tile_switch_template
+    // tile_switch_begin
+               << m_tile_switch_nets;
+  
+  obstream routing_graph_obs(routing_graph_s);
+  routing_graph_obs << m_routing_graph;
+  
+  std::vector<std::pair<std::string, std::string>> contents = {
+    std::make_pair("core", core_s.str()),
+    std::make_pair("tile_nets", tile_nets_s.str()),
+    std::make_pair("switches", switches_s.str()),
+    std::make_pair("routing_graph", routing_graph_s.str()),
+  };
+  
+  std::map<std::string, std::pair<size_t, size_t>> toc;
+  size_t offset = 0;
+  for (const auto &p : contents)
+    {
+      offset = (offset + 7) & ~(size_t)7;
+      extend(toc, p.first, std::make_pair(offset, p.second.size()));
+      offset += p.second.size();
+    }
+  
+  obs << std::string(chipdb_magic)
+      << chipdb_format_version
+      << std::string(version_str)
+      << toc;
+  for (const auto &p : contents)
+    {
+      obs.align(8);
+      obs.write(p.second.data(), p.second.size());
+    }
 }
 
 void
 ChipDB::bread(ibstream &ibs)
 {
-  std::vector<std::string> net_names;
-  std::vector<std::map<int, int>> tile_nets_idx;
+  std::string magic;
+  unsigned format_version;
+  ibs >> magic;
+  if (magic != chipdb_magic)
+    fatal("not a binary chipdb, or written by an older arachne-pnr");
+  ibs >> format_version;
+  if (format_version != chipdb_format_version)
+    fatal(fmt("unsupported binary chipdb format version " << format_version
+              << " (expected " << chipdb_format_version << ")"));
+  
   std::string dbversion;
   ibs >> dbversion;
   if(dbversion != version_str)
@@ -1047,68 +1962,189 @@ ChipDB::bread(ibstream &ibs)
               << ", arachne-pnr: "
               << version_str << ")"));
    }
-  ibs >> device
-      >> width
-      >> height
+  
+  ibs >> sections;
+  size_t size = 0;
+  for (const auto &p : sections)
+    size = std::max(size, p.second.first + p.second.second);
+  ibs.align(8);
+  section_base = ibs.in_place(size);
+  if (!section_base)
+    fatal("bread: binary chipdb must be read from memory");
+  
+  ibstream core_ibs = section("core");
+  core_ibs >> device
+           >> width
+           >> height
     // n_tiles = width * height
-      >> n_nets
+           >> n_nets
     // n_global_nets = 8
-      >> packages
-      >> loc_pin_glb_num
-      >> iolatch
-      >> ieren
-      >> extra_bits
-      >> gbufin
-      >> tile_colbuf_tile
-      >> tile_type
-    // net_tile_name
-      >> net_names
-      >> tile_nets_idx // tile_nets
-      >> tile_nonrouting_cbits
-      >> n_cells
-      >> cell_type
-      >> cell_location
-      >> cell_mfvs
-      >> cell_locked_pkgs
-      >> cell_type_cells
+           >> packages
+           >> loc_pin_glb_num
+           >> iolatch
+           >> ieren
+           >> extra_bits
+           >> gbufin
+           >> tile_colbuf_tile
+           >> tile_type
+           >> func_names
+           >> tile_func_cbits
+           >> n_cells
+           >> cell_type
+           >> cell_location
+           >> cell_mfvs
+           >> cell_locked_pkgs
+           >> cell_type_cells
     // bank_cells
-      >> switches
-    // in_switches, out_switches
-      >> tile_cbits_block_size;
+           >> tile_cbits_block_size;
   
   n_tiles = width * height;
   
-  tile_nets_idx.resize(n_tiles);
-  tile_nets.resize(n_tiles);
-  for (int i = 0; i < n_tiles; ++i)
-    {
-      for (const auto &p : tile_nets_idx[i])
-        extend(tile_nets[i], net_names[p.first], p.second);
-    }
-  
   finalize();
 }
 
-ChipDB *
-read_chipdb(const std::string &filename)
+// Map a binary chipdb read-only, or failing that read it into memory.
+static std::shared_ptr<const char>
+map_file(const std::string &filename, size_t &size)
 {
-  std::string expanded = expand_filename(filename);
-  std::ifstream ifs(expanded, std::ifstream::in | std::ifstream::binary);
+#ifndef _WIN32
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    fatal(fmt("read_chipdb: failed to open `" << filename << "': "
+              << strerror(errno)));
+  struct stat st;
+  if (fstat(fd, &st) == 0
+      && st.st_size > 0)
+    {
+      size = st.st_size;
+      void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED)
+        {
+          close(fd);
+          return std::shared_ptr<const char>(static_cast<const char *>(p),
+                                             [size](const char *q) {
+                                               munmap(const_cast<char *>(q), size);
+                                             });
+        }
+    }
+  close(fd);
+#endif
+  
+  std::ifstream ifs(filename, std::ifstream::in | std::ifstream::binary);
   if (ifs.fail())
-    fatal(fmt("read_chipdb: failed to open `" << expanded << "': "
+    fatal(fmt("read_chipdb: failed to open `" << filename << "': "
               << strerror(errno)));
-  ChipDB *chipdb;
-  if (is_suffix(expanded, ".bin"))
+  std::vector<char> *buf = new std::vector<char>(std::istreambuf_iterator<char>(ifs),
+                                                 std::istreambuf_iterator<char>());
+  size = buf->size();
+  return std::shared_ptr<const char>(buf->data(),
+                                     [buf](const char *) { delete buf; });
+}
+
+static ChipDB *
+read_binary_chipdb(const std::string &expanded)
+{
+  size_t size;
+  ChipDB *chipdb = new ChipDB;
+  chipdb->data = map_file(expanded, size);
+  ibstream ibs(chipdb->data.get(), size);
+  chipdb->bread(ibs);
+  return chipdb;
+}
+
+// 64-bit FNV-1a.
+static uint64_t
+hash_bytes(uint64_t h, const char *p, size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
     {
-      chipdb = new ChipDB;
-      ibstream ibs(ifs);
-      chipdb->bread(ibs);
+      h ^= (unsigned char)p[i];
+      h *= 0x100000001b3ull;
     }
-  else
+  return h;
+}
+
+static std::string
+chipdb_cache_file(const std::string &cache_dir, const char *text, size_t size)
+{
+  uint64_t h = 0xcbf29ce484222325ull;
+  h = hash_bytes(h, version_str, strlen(version_str));
+  h = hash_bytes(h, (const char *)&chipdb_format_version,
+                 sizeof chipdb_format_version);
+  h = hash_bytes(h, text, size);
+  
+  std::string name = "chipdb-";
+  for (int i = 60; i >= 0; i -= 4)
+    name.push_back(hexdigit((h >> i) & 0xf));
+  name += ".bin";
+  return expand_filename(cache_dir) + "/" + name;
+}
+
+static void
+write_chipdb_cache(const ChipDB *chipdb, const std::string &cache_file,
+                   const std::string &cache_dir)
+{
+  std::string expanded_dir = expand_filename(cache_dir);
+#ifdef _WIN32
+  _mkdir(expanded_dir.c_str());
+#else
+  mkdir(expanded_dir.c_str(), 0777);
+#endif
+  
+  // write to a private name and rename, so concurrent runs never see
+  // a partial file
+  std::string tmp = fmt(cache_file << ".tmp" << getpid());
+  {
+    std::ofstream ofs(tmp, std::ofstream::out | std::ofstream::binary);
+    if (ofs.fail())
+      {
+        warning(fmt("chipdb cache: failed to open `" << tmp << "': "
+                    << strerror(errno)));
+        return;
+      }
+    obstream obs(ofs);
+    chipdb->bwrite(obs);
+    ofs.close();
+    if (ofs.fail())
+      {
+        warning(fmt("chipdb cache: failed to write `" << tmp << "'"));
+        std::remove(tmp.c_str());
+        return;
+      }
+  }
+  if (std::rename(tmp.c_str(), cache_file.c_str()) != 0)
     {
-      ChipDBParser parser(filename, ifs);
-      chipdb = parser.parse();
+      warning(fmt("chipdb cache: failed to rename `" << tmp << "' to `"
+                  << cache_file << "': " << strerror(errno)));
+      std::remove(tmp.c_str());
     }
+}
+
+ChipDB *
+parse_chipdb(const std::string &filename, const char *text, size_t size,
+             int n_threads)
+{
+  return ChipDBParser::parse(filename, text, size, n_threads);
+}
+
+ChipDB *
+read_chipdb(const std::string &filename, const std::string &cache_dir)
+{
+  std::string expanded = expand_filename(filename);
+  if (is_suffix(expanded, ".bin"))
+    return read_binary_chipdb(expanded);
+  
+  size_t size;
+  std::shared_ptr<const char> text = map_file(expanded, size);
+  if (cache_dir.empty())
+    return parse_chipdb(filename, text.get(), size);
+  
+  std::string cache_file = chipdb_cache_file(cache_dir, text.get(), size);
+  if (std::ifstream(cache_file).good())
+    return read_binary_chipdb(cache_file);
+  
+  ChipDB *chipdb = parse_chipdb(filename, text.get(), size);
+  write_chipdb_cache(chipdb, cache_file, cache_dir);
   return chipdb;
 }
 
@@ -1146,7 +2182,7 @@ ChipDB::extra_cell_cbit(int c, const std::string &name, bool is_ip) const
      (tile_type[p.first] == TileType::DSP2) || (tile_type[p.first] == TileType::DSP3) ||
      (tile_type[p.first] == TileType::IPCON) || is_ip)
      prefix = "IpConfig.";
-  const auto &cbits = tile_nonrouting_cbits.at(tile_type[p.first]).at(prefix + p.second);
+  const auto &cbits = func_cbits(tile_type[p.first]).at(prefix + p.second);
   assert(cbits.size() == 1);
   const CBit &cbit0 = cbits[0];
   return cbit0.with_tile(p.first);
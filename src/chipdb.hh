@@ -26,6 +26,9 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <memory>
+#include <tuple>
+#include <algorithm>
 #include <cassert>
 
 class CBit
@@ -126,8 +129,136 @@ public:
   {}
 };
 
-obstream &operator<<(obstream &obs, const Switch &sw);
-ibstream &operator>>(ibstream &ibs, Switch &sw);
+// A switch of some tile, with its nets given as slots in the tile's
+// switch net table (ChipDB::tile_switch_nets) and its cbits without
+// the tile.  Tiles whose switches differ only in net numbering share
+// one list of patterns, a SwitchTemplate.
+class SwitchPattern
+{
+public:
+  bool bidir;
+  int out;
+  std::vector<std::pair<int, unsigned>> in_val;
+  std::vector<std::pair<int, int>> cbits; // row, col
+  
+  bool operator==(const SwitchPattern &rhs) const
+  {
+    return (bidir == rhs.bidir
+            && out == rhs.out
+            && in_val == rhs.in_val
+            && cbits == rhs.cbits);
+  }
+  bool operator<(const SwitchPattern &rhs) const
+  {
+    return (std::tie(bidir, out, in_val, cbits)
+            < std::tie(rhs.bidir, rhs.out, rhs.in_val, rhs.cbits));
+  }
+};
+
+typedef std::vector<SwitchPattern> SwitchTemplate;
+
+// What it takes to set a switch to one of its inputs: the switch's
+// cbits in tile (as rows and columns) and the value selecting it.
+class SwitchSetting
+{
+public:
+  int tile;
+  const std::vector<std::pair<int, int>> *cbits;
+  unsigned value;
+};
+
+obstream &operator<<(obstream &obs, const SwitchPattern &sp);
+ibstream &operator>>(ibstream &ibs, SwitchPattern &sp);
+
+enum class SpanType : int {
+  OTHER, LOCAL, SPAN4, SPAN12, GLOBAL
+};
+
+std::string span_type_name(SpanType st);
+
+// intrinsic delay (ps) of a routing node of type st, roughly
+// following the iCE40 timing model.
+int span_type_delay(SpanType st);
+
+inline obstream &operator<<(obstream &obs, SpanType st)
+{
+  return obs << static_cast<int>(st);
+}
+
+inline ibstream &operator>>(ibstream &ibs, SpanType &st)
+{
+  int x;
+  ibs >> x;
+  st = static_cast<SpanType>(x);
+  return ibs;
+}
+
+class ChipDB;
+
+// Packed routing-resource graph.  Nodes are chipdb nets, edges are
+// switch inputs.  The fanout of net i is out_net[out_begin[i]]
+// .. out_net[out_begin[i + 1] - 1], and its fanin is likewise
+// in_net[in_begin[i]] .. in_net[in_begin[i + 1] - 1], sorted.  Each
+// fanin edge e also records the switch implementing it and the value
+// that selects in_net[e] on it.  Per-net data is kept in
+// struct-of-arrays form.
+//
+// lookahead is a heuristic estimate of the base cost of reaching a
+// sink (a net without fanout) at least dx, dy tiles away from a net
+// of a given span type, distances being between the bounding boxes
+// of the tiles the nets span.  It is sampled from a few nets of each
+// type and scaled down, so it usually but not always underestimates
+// (see lookahead_scale_percent).  It is built with the graph and
+// stored in the binary chipdb.
+class RoutingGraph
+{
+public:
+  FlatVector<int> out_begin;
+  FlatVector<int> out_net;
+  FlatVector<int> in_begin;
+  FlatVector<int> in_net;
+  FlatVector<int> in_switch;
+  FlatVector<unsigned> in_switch_val;
+  
+  FlatVector<int> net_base_cost;
+  FlatVector<SpanType> net_span_type;
+  FlatVector<int> net_delay;  // ps
+  FlatVector<int> net_tile;
+  
+  int width, height;
+  FlatVector<int> lookahead;
+  
+public:
+  RoutingGraph()
+    : width(0), height(0)
+  {}
+  
+  bool empty() const { return out_begin.empty(); }
+  int n_nets() const { return (int)net_tile.size(); }
+  
+  int lookahead_cost(SpanType st, int dx, int dy) const
+  {
+    assert(dx >= 0 && dx < width);
+    assert(dy >= 0 && dy < height);
+    return lookahead[(static_cast<int>(st) * height + dy) * width + dx];
+  }
+  
+  // fanin edge of out from in
+  int in_edge(int in, int out) const
+  {
+    auto b = in_net.begin() + in_begin[out],
+      e = in_net.begin() + in_begin[out + 1];
+    auto i = std::lower_bound(b, e, in);
+    assert(i != e && *i == in);
+    return (int)(i - in_net.begin());
+  }
+  
+  void build(const ChipDB *chipdb);
+  void build_lookahead(const ChipDB *chipdb);
+};
+
+obstream &operator<<(obstream &obs, const RoutingGraph &g);
+ibstream &operator>>(ibstream &ibs, RoutingGraph &g);
 
 enum class TileType : int {
   EMPTY, IO, LOGIC, RAMB, RAMT, DSP0, DSP1, DSP2, DSP3, IPCON
@@ -159,6 +290,10 @@ constexpr int cell_type_idx(CellType type)
 
 static const int n_cell_types = cell_type_idx(CellType::IO_I3C) + 1;
 
+// Ports of LOGIC, IO and GB cells whose routing nets are tabulated in
+// ChipDB::cell_port_net.  Empty for other cell types.
+const std::vector<std::string> &cell_type_ports(CellType type);
+
 inline obstream &operator<<(obstream &obs, CellType t)
 {
   return obs << static_cast<int>(t);
@@ -189,6 +324,66 @@ public:
 
 std::string tile_type_name(TileType t);
 
+// Interned names: sorted and without duplicates, so a name's id is
+// its index and ids compare like the names.
+class SymbolTable
+{
+  friend obstream &operator<<(obstream &obs, const SymbolTable &st);
+  friend ibstream &operator>>(ibstream &ibs, SymbolTable &st);
+  
+  std::vector<std::string> names;
+  
+public:
+  SymbolTable() {}
+  SymbolTable(std::vector<std::string> names_);
+  
+  int size() const { return names.size(); }
+  const std::string &name(int i) const { return names[i]; }
+  
+  // -1 if absent
+  int id(const std::string &name) const;
+};
+
+inline obstream &operator<<(obstream &obs, const SymbolTable &st)
+{
+  return obs << st.names;
+}
+
+inline ibstream &operator>>(ibstream &ibs, SymbolTable &st)
+{
+  return ibs >> st.names;
+}
+
+// The function (nonrouting) cbits of one tile type, by function id
+// (see ChipDB::func_names) or name.
+class FuncCBits
+{
+  const SymbolTable *func_names;
+  const std::vector<std::vector<CBit>> *cbits;
+  
+public:
+  FuncCBits(const SymbolTable *fn, const std::vector<std::vector<CBit>> *cb)
+    : func_names(fn), cbits(cb)
+  {}
+  
+  bool contains(int f) const { return f >= 0 && !(*cbits)[f].empty(); }
+  const std::vector<CBit> &at(int f) const
+  {
+    if (!contains(f))
+      fatal(fmt("no cbits for function `"
+                << (f >= 0 ? func_names->name(f) : std::string("?"))
+                << "' in this tile type"));
+    return (*cbits)[f];
+  }
+  const std::vector<CBit> &at(const std::string &name) const
+  {
+    int f = func_names->id(name);
+    if (f < 0)
+      fatal(fmt("unknown chipdb function `" << name << "'"));
+    return at(f);
+  }
+};
+
 class Package
 {
   friend obstream &operator<<(obstream &obs, const Package &pkg);
@@ -216,6 +411,8 @@ inline ibstream &operator>>(ibstream &ibs, Package &pkg)
 
 class ChipDB
 {
+  friend class ChipDBParser;
+  
 public:
   std::string device;
   
@@ -225,7 +422,6 @@ public:
   int n_tiles;
   int n_nets;
   int n_global_nets;
-  std::map<int, int> net_global;
   
   std::map<std::string, Package> packages;
   
@@ -237,15 +433,21 @@ public:
   
   std::map<std::pair<int, int>, int> gbufin;
   
-  std::map<int, int> tile_colbuf_tile;
+  // column buffer tile of each tile, or -1
+  std::vector<int> tile_colbuf_tile;
   
   std::vector<TileType> tile_type;
-  std::vector<std::pair<int, std::string>> net_tile_name;
-  std::vector<std::map<std::string, int>> tile_nets;
-  
-  std::map<TileType,
-          std::map<std::string, std::vector<CBit>>>
-    tile_nonrouting_cbits;
+  int tile_net(int t, int name) const;
+  int tile_net(int t, const std::string &name) const;
+  
+  // tile_func_cbits[ty][f] are the cbits (with tile 0) of function
+  // func_names.name(f) in tiles of type ty, or empty
+  SymbolTable func_names;
+  std::map<TileType, std::vector<std::vector<CBit>>> tile_func_cbits;
+  int func_id(const std::string &name) const { return func_names.id(name); }
+  FuncCBits func_cbits(TileType ty) const;
+  void set_func_cbits(const std::map<TileType,
+                                     std::map<std::string, std::vector<CBit>>> &m);
   
   CBit extra_cell_cbit(int ec, const std::string &name, bool is_ip = false) const;
   std::string extra_cell_netname(int ec, const std::string &name) const;
@@ -268,11 +470,69 @@ public:
   
   std::vector<std::vector<int>> bank_cells;
   
-  // buffers and routing
-  std::vector<Switch> switches;
+  // A binary chipdb is read lazily: bread reads only the core
+  // section, and the tile nets, switches and routing graph below are
+  // read from the image on first use.  The routing graph of a text
+  // chipdb is built on first use.
   
-  std::vector<std::set<int>> out_switches;
-  std::vector<std::set<int>> in_switches;
+  // net_global()[i] is the global network routing net i is, or -1
+  const std::vector<int> &net_global() const
+  {
+    load_tile_nets();
+    return m_net_global;
+  }
+  // a (tile, local name) of each net, for diagnostics.  Empty for a
+  // binary chipdb.
+  const std::vector<std::pair<int, std::string>> &net_tile_name() const
+  {
+    load_tile_nets();
+    return m_net_tile_name;
+  }
+  // tile_nets()[t] maps the local names in tile t, as net_names() ids,
+  // to routing nets, sorted by name, see tile_net()
+  const SymbolTable &net_names() const
+  {
+    load_tile_nets();
+    return m_net_names;
+  }
+  const std::vector<std::vector<std::pair<int, int>>> &tile_nets() const
+  {
+    load_tile_nets();
+    return m_tile_nets;
+  }
+  // cell_port_net()[c][i] is the routing net of port
+  // cell_type_ports(cell_type[c])[i] of cell c, or -1
+  const BasedVector<std::vector<int>, 1> &cell_port_net() const
+  {
+    load_tile_nets();
+    return m_cell_port_net;
+  }
+  
+  // buffers and routing.  Switches are numbered by tile, and slot i
+  // in the patterns of tile t is net tile_switch_nets()[t][i].
+  const std::vector<std::vector<int>> &tile_switch_nets() const
+  {
+    load_switches();
+    return m_tile_switch_nets;
+  }
+  int n_switches() const
+  {
+    load_switches();
+    return m_tile_switch_begin.back();
+  }
+  const SwitchTemplate &tile_switches(int t) const;
+  int switch_tile(int s) const;
+  Switch get_switch(int s) const;
+  // without building a Switch
+  int switch_out(int s) const;
+  SwitchSetting switch_setting(int s, int in) const;
+  void set_switches(const std::vector<Switch> &switches);
+  
+  const RoutingGraph &routing_graph() const
+  {
+    load_routing_graph();
+    return m_routing_graph;
+  }
   
   std::map<TileType, std::pair<int, int>> tile_cbits_block_size;
   
@@ -312,9 +572,47 @@ public:
     return ramb_t;
   }
   
+  // binary chipdb image the routing graph may refer to
+  std::shared_ptr<const char> data;
+  
   void set_device(const std::string &d, int w, int h, int n_nets_);
   void finalize();
   
+private:
+  // read lazily, see above
+  mutable std::vector<int> m_net_global;
+  mutable std::vector<std::pair<int, std::string>> m_net_tile_name;
+  mutable SymbolTable m_net_names;
+  mutable std::vector<std::vector<std::pair<int, int>>> m_tile_nets;
+  mutable BasedVector<std::vector<int>, 1> m_cell_port_net;
+  
+  // the switches of tile t are m_tile_switch_begin[t] up to
+  // m_tile_switch_begin[t + 1], following
+  // m_switch_templates[m_tile_switch_template[t]]
+  mutable std::vector<SwitchTemplate> m_switch_templates;
+  mutable std::vector<int> m_tile_switch_template; // -1 if none
+  mutable std::vector<int> m_tile_switch_begin;
+  mutable std::vector<std::vector<int>> m_tile_switch_nets;
+  
+  mutable RoutingGraph m_routing_graph;
+  
+  // binary chipdb table of contents: section name to offset and size
+  // relative to section_base
+  std::map<std::string, std::pair<size_t, size_t>> sections;
+  const char *section_base;
+  mutable bool tile_nets_loaded;
+  mutable bool switches_loaded;
+  mutable bool routing_graph_loaded;
+  
+  ibstream section(const std::string &name) const;
+  // materialise a section of a binary chipdb.  For a text chipdb
+  // only load_routing_graph does anything: it builds the graph.
+  void load_tile_nets() const;
+  void load_switches() const;
+  void load_routing_graph() const;
+  void finalize_tile_nets() const;
+  void build_cell_port_net() const;
+  
 public:
   ChipDB();
   
@@ -323,6 +621,33 @@ public:
   void bread(ibstream &ibs);
 };
 
-ChipDB *read_chipdb(const std::string &filename);
+// Binary chipdb layout: magic string, format version, version_str,
+// the table of contents, then the sections (core, tile_nets,
+// switches, routing_graph), each 8-byte aligned.  Integers are LEB128
+// except in FlatVectors (the routing graph), which are 4-byte aligned
+// little-endian arrays used in place when the chipdb is mapped.
+//
+// Only routing_graph is flat so far.  core, tile_nets and switches are
+// still decoded into maps, strings and nested vectors on load; making
+// them flat arrays too means changing their users to match.
+extern const char *const chipdb_magic;
+static const unsigned chipdb_format_version = 5;
+
+// Parses the text chipdb text, read from filename, splitting the
+// routing directives over n_threads threads (by default one per
+// core, at most 16).  The result does not depend on n_threads.
+ChipDB *parse_chipdb(const std::string &filename,
+                     const char *text, size_t size,
+                     int n_threads = 0);
+
+// If cache_dir is not empty, a text chipdb is read through a binary
+// copy in cache_dir named for a hash of its contents and version_str,
+// which is written on first use.
+ChipDB *read_chipdb(const std::string &filename,
+                    const std::string &cache_dir = std::string());
+
+// Returns the chipdb for device compiled into the executable (see
+// chipdb_embed.cc), or nullptr if there is none.
+ChipDB *read_embedded_chipdb(const std::string &device);
 
 #endif
@@ -0,0 +1,86 @@
+/* Copyright (C) 2015 Cotton Seed
+   
+   This file is part of arachne-pnr.  Arachne-pnr is free software;
+   you can redistribute it and/or modify it under the terms of the GNU
+   General Public License version 2 as published by the Free Software
+   Foundation.
+   
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program. If not, see <http://www.gnu.org/licenses/>. */
+
+#include "chipdb.hh"
+#include "bstream.hh"
+
+#include <cstring>
+
+// Binary chipdbs compiled into the executable.  EMBED_CHIPDBS is a
+// list EMBED_CHIPDB(<device>) ..., set by the Makefile for
+// bin/arachne-pnr-embedded; each share/arachne-pnr/chipdb-<device>.bin
+// is included verbatim by the assembler, 16-byte aligned so the
+// routing graph can be used in place.
+#ifndef EMBED_CHIPDBS
+#define EMBED_CHIPDBS
+#endif
+
+#if defined(__APPLE__)
+#define EMBED_SECTION "__TEXT,__const"
+#elif defined(_WIN32)
+#define EMBED_SECTION ".rdata,\"dr\""
+#else
+#define EMBED_SECTION ".rodata"
+#endif
+
+#define EMBED_STR2(x) #x
+#define EMBED_STR(x) EMBED_STR2(x)
+#define EMBED_SYMBOL(name) EMBED_STR(__USER_LABEL_PREFIX__) #name
+
+#define EMBED_CHIPDB(d)                                                 \
+  extern "C" const char chipdb_##d##_begin[], chipdb_##d##_end[];      \
+  asm(".pushsection " EMBED_SECTION "\n"                                \
+      ".balign 16\n"                                                    \
+      ".globl " EMBED_SYMBOL(chipdb_##d##_begin) "\n"                   \
+      EMBED_SYMBOL(chipdb_##d##_begin) ":\n"                            \
+      ".incbin \"share/arachne-pnr/chipdb-" #d ".bin\"\n"               \
+      ".globl " EMBED_SYMBOL(chipdb_##d##_end) "\n"                     \
+      EMBED_SYMBOL(chipdb_##d##_end) ":\n"                              \
+      ".popsection\n");
+EMBED_CHIPDBS
+#undef EMBED_CHIPDB
+
+class EmbeddedChipDB
+{
+public:
+  const char *device;
+  const char *begin;
+  const char *end;
+};
+
+static const EmbeddedChipDB embedded_chipdbs[] = {
+#define EMBED_CHIPDB(d) { #d, chipdb_##d##_begin, chipdb_##d##_end },
+  EMBED_CHIPDBS
+#undef EMBED_CHIPDB
+  { nullptr, nullptr, nullptr },
+};
+
+ChipDB *
+read_embedded_chipdb(const std::string &device)
+{
+  for (const EmbeddedChipDB *e = embedded_chipdbs; e->device; ++e)
+    {
+      if (device != e->device)
+        continue;
+      
+      ChipDB *chipdb = new ChipDB;
+      // static data, nothing to free
+      chipdb->data = std::shared_ptr<const char>(e->begin, [](const char *) {});
+      ibstream ibs(e->begin, e->end - e->begin);
+      chipdb->bread(ibs);
+      return chipdb;
+    }
+  return nullptr;
+}
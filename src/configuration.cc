@@ -17,21 +17,70 @@
 #include "chipdb.hh"
 #include "util.hh"
 #include "netlist.hh"
+#include "line_parser.hh"
 
 #include <cassert>
+#include <cstring>
 #include <iostream>
+#include <fstream>
 
-Configuration::Configuration()
+Configuration::Configuration(const ChipDB *chipdb_)
+  : chipdb(chipdb_),
+    tile_row_begin(chipdb->n_tiles + 1),
+    tile_width(chipdb->n_tiles, 0)
 {
+  for (const auto &p : chipdb->tile_cbits_block_size)
+    if (p.second.first > 64)
+      fatal(fmt(tile_type_name(p.first) << " tiles are wider than 64 bits"));
+  
+  tile_row_begin[0] = 0;
+  for (int t = 0; t < chipdb->n_tiles; ++t)
+    {
+      auto i = chipdb->tile_cbits_block_size.find(chipdb->tile_type[t]);
+      int bh = 0;
+      if (i != chipdb->tile_cbits_block_size.end())
+        {
+          tile_width[t] = i->second.first;
+          bh = i->second.second;
+        }
+      tile_row_begin[t + 1] = tile_row_begin[t] + bh;
+    }
+  tile_row_word.resize(tile_row_begin.back(), 0);
+  tile_row_set.resize(tile_row_begin.back(), 0);
+}
+
+int
+Configuration::row_word(const CBit &cbit) const
+{
+  // a bad cbit would otherwise land in another tile's rows
+  if (cbit.tile < 0 || cbit.tile >= chipdb->n_tiles
+      || cbit.row < 0
+      || tile_row_begin[cbit.tile] + cbit.row >= tile_row_begin[cbit.tile + 1]
+      || cbit.col < 0 || cbit.col >= tile_width[cbit.tile])
+    fatal(fmt("configuration bit " << cbit << " out of range"));
+  return tile_row_begin[cbit.tile] + cbit.row;
+}
+
+bool
+Configuration::get_cbit(const CBit &value_cbit) const
+{
+  int w = row_word(value_cbit);
+  return (tile_row_word[w] >> value_cbit.col) & 1;
 }
 
 void
 Configuration::set_cbit(const CBit &value_cbit, bool value)
 {
-  assert(!contains_key(cbits, value_cbit)
-         || cbits.at(value_cbit) == value);
+  int w = row_word(value_cbit);
+  uint64_t m = (uint64_t)1 << value_cbit.col;
+  assert(!(tile_row_set[w] & m)
+         || (bool)(tile_row_word[w] & m) == value);
+  tile_row_set[w] |= m;
   // *logs << value_cbit << " = " << value << "\n";
-  cbits[value_cbit] = value;
+  if (value)
+    tile_row_word[w] |= m;
+  else
+    tile_row_word[w] &= ~m;
 }
 
 void
@@ -42,6 +91,16 @@ Configuration::set_cbits(const std::vector<CBit> &value_cbits,
     set_cbit(value_cbits[i], (bool)(value & (1 << i)));
 }
 
+void
+Configuration::set_cbits(int t,
+                         const std::vector<std::pair<int, int>> &value_cbits,
+                         unsigned value)
+{
+  for (unsigned i = 0; i < value_cbits.size(); ++i)
+    set_cbit(CBit(t, value_cbits[i].first, value_cbits[i].second),
+             (bool)(value & (1 << i)));
+}
+
 void
 Configuration::set_extra_cbit(const std::tuple<int, int, int> &t)
 {
@@ -50,7 +109,6 @@ Configuration::set_extra_cbit(const std::tuple<int, int, int> &t)
 
 void
 Configuration::write_txt(std::ostream &s,
-                         const ChipDB *chipdb,
                          Design *d,
                          const std::map<Instance *, int, IdLess> &placement,
                          const std::vector<Net *> &cnet_net)
@@ -68,25 +126,14 @@ Configuration::write_txt(std::ostream &s,
         y = chipdb->tile_y(t);
       s << "." << tile_type_name(ty) << " " << x << " " << y << "\n";
       
-      int bw, bh;
-      std::tie(bw, bh) = chipdb->tile_cbits_block_size.at(ty);
-      
-      for (int r = 0; r < bh; r ++)
+      int bw = chipdb->tile_cbits_block_size.at(ty).first;
+      std::string line(bw + 1, '\n');
+      for (int w = tile_row_begin[t]; w < tile_row_begin[t + 1]; ++w)
         {
-          for (int c = 0; c < bw; c ++)
-            {
-              auto i = cbits.find(CBit(t, r, c));
-              if (i != cbits.end())
-                {
-                  if (i->second)
-                    s << "1";
-                  else
-                    s << "0";
-                }
-              else
-                s << "0";
-            }
-          s << "\n";
+          uint64_t word = tile_row_word[w];
+          for (int c = 0; c < bw; ++c)
+            line[c] = ((word >> c) & 1) ? '1' : '0';
+          s << line;
         }
     }
   
@@ -136,3 +183,95 @@ Configuration::write_txt(std::ostream &s,
         s << ".sym " << i << " " << n->name() << "\n";
     }
 }
+
+class ASCParser : public LineParser
+{
+  const ChipDB *chipdb;
+  Configuration &conf;
+  
+public:
+  ASCParser(const std::string &f, std::istream &s_,
+            const ChipDB *chipdb_, Configuration &conf_)
+    : LineParser(f, s_),
+      chipdb(chipdb_),
+      conf(conf_)
+  {}
+  
+  void parse();
+};
+
+void
+ASCParser::parse()
+{
+  std::map<std::string, TileType> name_tile_type;
+  for (const auto &p : chipdb->tile_cbits_block_size)
+    name_tile_type[tile_type_name(p.first)] = p.first;
+  
+  for (;;)
+    {
+      if (eof())
+        break;
+      
+      read_line();
+      // skips .ram_data contents, etc.
+      if (words.empty()
+          || words[0][0] != '.')
+        continue;
+      
+      const std::string &cmd = words[0];
+      if (cmd == ".device")
+        {
+          if (words.size() != 2)
+            fatal("invalid .device entry");
+          if (words[1] != chipdb->device)
+            fatal(fmt("device `" << words[1]
+                      << "' does not match chipdb device `" << chipdb->device << "'"));
+          continue;
+        }
+      
+      auto i = name_tile_type.find(cmd.substr(1));
+      if (i == name_tile_type.end())
+        continue;
+      
+      if (words.size() != 3)
+        fatal(fmt("invalid " << cmd << " entry"));
+      int x = std::stoi(words[1]),
+        y = std::stoi(words[2]);
+      if (x < 0 || x >= chipdb->width
+          || y < 0 || y >= chipdb->height)
+        fatal(fmt("tile " << x << " " << y << " out of range"));
+      int t = chipdb->tile(x, y);
+      if (chipdb->tile_type[t] != i->second)
+        fatal(fmt("tile " << x << " " << y << " is not a " << cmd.substr(1)));
+      
+      int bw, bh;
+      std::tie(bw, bh) = chipdb->tile_cbits_block_size.at(i->second);
+      for (int r = 0; r < bh; ++r)
+        {
+          read_line();
+          if (words.size() != 1
+              || (int)words[0].size() != bw)
+            fatal(fmt("expected " << bw << " tile bits"));
+          for (int col = 0; col < bw; ++col)
+            {
+              char ch = words[0][col];
+              if (ch == '1')
+                conf.set_cbit(CBit(t, r, col), true);
+              else if (ch != '0')
+                fatal(fmt("invalid tile bit `" << ch << "'"));
+            }
+        }
+    }
+}
+
+void
+Configuration::read_txt(const std::string &filename)
+{
+  std::string expanded = expand_filename(filename);
+  std::ifstream fs(expanded);
+  if (fs.fail())
+    fatal(fmt("read_txt: failed to open `" << expanded << "': "
+              << strerror(errno)));
+  ASCParser parser(filename, fs, chipdb, *this);
+  parser.parse();
+}
@@ -18,6 +18,7 @@
 
 #include "chipdb.hh"
 #include <ostream>
+#include <cstdint>
 
 class Design;
 class Instance;
@@ -27,22 +28,41 @@ class IdLess;
 class Configuration
 {
 private:
-  std::map<CBit, bool> cbits;
+  const ChipDB *chipdb;
+  
+  // Tile bits, one word per row (bit c is column c): tile t's rows
+  // are tile_row_word[tile_row_begin[t]] onwards, tile_width[t] bits
+  // wide.
+  std::vector<int> tile_row_begin;
+  std::vector<int> tile_width;
+  std::vector<uint64_t> tile_row_word;
+  // bits explicitly set, likewise, to catch conflicting settings
+  std::vector<uint64_t> tile_row_set;
   std::set<std::tuple<int, int, int>> extra_cbits;
   
+  // fatal if cbit is outside its tile
+  int row_word(const CBit &cbit) const;
+  
 public:
-  Configuration();
+  Configuration(const ChipDB *chipdb_);
   
+  bool get_cbit(const CBit &cbit) const;
   void set_cbit(const CBit &cbit, bool value);
   void set_cbits(const std::vector<CBit> &value_cbits,
                  unsigned value);
+  // cbits given as (row, col) in tile t
+  void set_cbits(int t,
+                 const std::vector<std::pair<int, int>> &value_cbits,
+                 unsigned value);
   void set_extra_cbit(const std::tuple<int, int, int> &t);
   
   void write_txt(std::ostream &s,
-                 const ChipDB *chipdb,
                  Design *d,
                  const std::map<Instance *, int, IdLess> &placement,
                  const std::vector<Net *> &cnet_net);
+  
+  // read back the tile bits of a .asc file written by write_txt
+  void read_txt(const std::string &filename);
 };
 
 #endif
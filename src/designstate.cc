@@ -20,7 +20,8 @@ DesignState::DesignState(const ChipDB *chipdb_, const Package &package_, Design
     package(package_),
     d(d_),
     models(d_),
-    top(d_->top())
+    top(d_->top()),
+    conf(chipdb_)
 {
 }
 
@@ -39,6 +39,14 @@ LexicalPosition::warning(const std::string &msg) const
   std::cerr << *this << ": warning: " << msg << "\n";
 }
 
+void
+LineParser::fatal(const std::string &msg) const
+{
+  if (throw_errors)
+    throw Error(lp, msg);
+  lp.fatal(msg);
+}
+
 void
 LineParser::split_line()
 {
@@ -51,13 +51,32 @@ class LineParser
 {
   std::istream &s;
   
+public:
+  // thrown by fatal instead of exiting if throw_errors is set, so a
+  // parser running on a worker thread can hand its error to the main
+  // thread
+  class Error
+  {
+  public:
+    LexicalPosition lp;
+    std::string msg;
+    
+  public:
+    Error(const LexicalPosition &lp_, const std::string &msg_)
+      : lp(lp_), msg(msg_)
+    {}
+    
+    void fatal() const { lp.fatal(msg); }
+  };
+  
 protected:
   LexicalPosition lp;
+  bool throw_errors;
   
   std::string line;
   std::vector<std::string> words;
   
-  void fatal(const std::string &msg) const { lp.fatal(msg); }
+  void fatal(const std::string &msg) const;
   void warning(const std::string &msg) const { lp.warning(msg); }
   
   bool eof() { return s.eof(); }
@@ -66,7 +85,11 @@ protected:
   void read_line();
   
   LineParser(const std::string &f, std::istream &s_)
-    : s(s_), lp(f)
+    : s(s_), lp(f), throw_errors(false)
+  {}
+  // s_ starts at line first_line of f
+  LineParser(const std::string &f, std::istream &s_, int first_line)
+    : s(s_), lp(f, first_line - 1), throw_errors(false)
   {}
 };
 
@@ -178,6 +178,7 @@ Node::add_port(Port *t)
 {
   Port *new_port = new Port(this, t->name(), t->direction(), t->undriven());
   extend(m_ports, new_port->name(), new_port);
+  new_port->m_index = m_ordered_ports.size();
   m_ordered_ports.push_back(new_port);
   return new_port;
 }
@@ -187,6 +188,7 @@ Node::add_port(const std::string &n, Direction dir)
 {
   Port *new_port = new Port(this, n, dir);
   extend(m_ports, new_port->name(), new_port);
+  new_port->m_index = m_ordered_ports.size();
   m_ordered_ports.push_back(new_port);
   return new_port;
 }
@@ -196,6 +198,7 @@ Node::add_port(const std::string &n, Direction dir, Value u)
 {
   Port *new_port = new Port(this, n, dir, u);
   extend(m_ports, new_port->name(), new_port);
+  new_port->m_index = m_ordered_ports.size();
   m_ordered_ports.push_back(new_port);
   return new_port;
 }
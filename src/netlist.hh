@@ -183,28 +183,33 @@ public:
 
 class Port : public Identified
 {
+  friend class Node;
+  
   Node *m_node;
   std::string m_name;
   Direction m_dir;
   Value m_undriven;
   Net *m_connection;
+  int m_index;
   
 public:
   Node *node() const { return m_node; }
   const std::string &name() const { return m_name; }
+  // position in node()->ordered_ports()
+  int index() const { return m_index; }
   Direction direction() const { return m_dir; }
   void set_direction(Direction dir) { m_dir = dir; }
   Value undriven() const { return m_undriven; }
   void set_undriven(Value u) { m_undriven = u; }
   
   Port(Node *node_, const std::string &name_)
-    : m_node(node_), m_name(name_), m_dir(Direction::IN), m_undriven(Value::X), m_connection(nullptr)
+    : m_node(node_), m_name(name_), m_dir(Direction::IN), m_undriven(Value::X), m_connection(nullptr), m_index(-1)
   {}
   Port(Node *node_, const std::string &name_, Direction dir)
-    : m_node(node_), m_name(name_), m_dir(dir), m_undriven(Value::X), m_connection(nullptr)
+    : m_node(node_), m_name(name_), m_dir(dir), m_undriven(Value::X), m_connection(nullptr), m_index(-1)
   {}
   Port(Node *node_, const std::string &name_, Direction dir, Value u)
-    : m_node(node_), m_name(name_), m_dir(dir), m_undriven(u), m_connection(nullptr)
+    : m_node(node_), m_name(name_), m_dir(dir), m_undriven(u), m_connection(nullptr), m_index(-1)
   {}
   ~Port()
   {
@@ -1332,7 +1332,7 @@ Placer::configure_io(const Location &loc,
                      bool weak_pullup,
                      std::string pullup_strength)
 {
-  const auto &func_cbits = chipdb->tile_nonrouting_cbits.at(TileType::IO);
+  FuncCBits func_cbits = chipdb->func_cbits(TileType::IO);
   const CBit &ie_0 = func_cbits.at("IoCtrl.IE_0")[0],
     &ie_1 = func_cbits.at("IoCtrl.IE_1")[0],
     &ren_0 = func_cbits.at("IoCtrl.REN_0")[0],
@@ -1487,6 +1487,17 @@ Placer::configure_extra_cell(int c,
 void
 Placer::configure()
 {
+  // function bits set for every LC and IO
+  int lc_func[8];
+  for (int i = 0; i < 8; ++i)
+    lc_func[i] = chipdb->func_id(fmt("LC_" << i));
+  int pintype_func[2][6];
+  for (int i = 0; i < 2; ++i)
+    for (int j = 0; j < 6; ++j)
+      pintype_func[i][j] = chipdb->func_id(fmt("IOB_" << i << ".PINTYPE_" << j));
+  int negclk_func = chipdb->func_id("NegClk"),
+    carryinset_func = chipdb->func_id("CarryInSet");
+  
   for (int g = 1; g <= n_gates; g ++)
     {
       Instance *inst = gates[g];
@@ -1563,7 +1574,7 @@ Placer::configure()
       }
       
       int t = loc.tile();
-      const auto &func_cbits = chipdb->tile_nonrouting_cbits.at(chipdb->tile_type[t]);
+      FuncCBits func_cbits = chipdb->func_cbits(chipdb->tile_type[t]);
       
       if (models.is_lc(inst))
         {
@@ -1574,7 +1585,7 @@ Placer::configure()
             4, 14, 15, 5, 6, 16, 17, 7, 3, 13, 12, 2, 1, 11, 10, 0,
           };
           
-          const auto &cbits = func_cbits.at(fmt("LC_" << loc.pos()));
+          const auto &cbits = func_cbits.at(lc_func[loc.pos()]);
           for (int i = 0; i < 16; ++i)
             conf.set_cbit(CBit(t,
                                cbits[lut_perm[i]].row,
@@ -1592,7 +1603,7 @@ Placer::configure()
                   Net *n = inst->find_port("CIN")->connection();
                   if (n && n->is_constant())
                     {
-                      const CBit &carryinset_cbit = func_cbits.at("CarryInSet")[0];
+                      const CBit &carryinset_cbit = func_cbits.at(carryinset_func)[0];
                       conf.set_cbit(CBit(t,
                                          carryinset_cbit.row,
                                          carryinset_cbit.col), 
@@ -1609,7 +1620,7 @@ Placer::configure()
           if (dff_enable)
             {
               bool neg_clk = inst->get_param("NEG_CLK").get_bit(0);
-              const CBit &neg_clk_cbit = func_cbits.at("NegClk")[0];
+              const CBit &neg_clk_cbit = func_cbits.at(negclk_func)[0];
               conf.set_cbit(CBit(t,
                                  neg_clk_cbit.row,
                                  neg_clk_cbit.col),
@@ -1637,14 +1648,14 @@ Placer::configure()
           }
           for (int i = 0; i < 6; ++i)
             {
-              const CBit &cbit = func_cbits.at(fmt("IOB_" << loc.pos() << ".PINTYPE_" << i))[0];
+              const CBit &cbit = func_cbits.at(pintype_func[loc.pos()][i])[0];
               conf.set_cbit(CBit(t, 
                                  cbit.row, 
                                  cbit.col),
                             pin_type[i]);
             }
           
-          const auto &negclk_cbits = func_cbits.at("NegClk");
+          const auto &negclk_cbits = func_cbits.at(negclk_func);
           bool neg_trigger = inst->get_param("NEG_TRIGGER").get_bit(0);
           for (int i = 0; i <= 1; ++i)
             conf.set_cbit(CBit(t,
@@ -1671,7 +1682,7 @@ Placer::configure()
           rm.resize(2);
           
           // powerup active low, don't set
-          const auto &ramb_func_cbits = chipdb->tile_nonrouting_cbits.at(TileType::RAMB);
+          FuncCBits ramb_func_cbits = chipdb->func_cbits(TileType::RAMB);
           const CBit &cbit0 = func_cbits.at("RamConfig.CBIT_0")[0],
             &cbit1 = func_cbits.at("RamConfig.CBIT_1")[0],
             &cbit2 = func_cbits.at("RamConfig.CBIT_2")[0],
@@ -1726,7 +1737,7 @@ Placer::configure()
         //Used DSP tiles must have LC and cascade bits set correctly to function, as these are
         //used for an unknown internal purpose
         for(int dsp_idx = 0; dsp_idx < 4; dsp_idx++) {
-          const auto &dspi_func_cbits = chipdb->tile_nonrouting_cbits.at(TileType::DSP0);
+          FuncCBits dspi_func_cbits = chipdb->func_cbits(TileType::DSP0);
           int dspt = chipdb->tile(x, y + dsp_idx);
           for(int lc_idx = 0; lc_idx < 8; lc_idx++) {
             const auto &cbits = dspi_func_cbits.at(fmt("LC_" << lc_idx));
@@ -1987,7 +1998,7 @@ Placer::configure()
   
   // set IoCtrl configuration bits
   {
-    const auto &func_cbits = chipdb->tile_nonrouting_cbits.at(TileType::IO);
+    FuncCBits func_cbits = chipdb->func_cbits(TileType::IO);
     const CBit &lvds_cbit = func_cbits.at("IoCtrl.LVDS")[0];
     
     std::map<Location, int> loc_pll;
@@ -2133,7 +2144,7 @@ Placer::configure()
       if(chipdb->tile_x(t) == 25 && chipdb->tile_y(t) == 14)
         continue; //Bits not set on this tile only
       
-      const auto &ipcon_func_cbits = chipdb->tile_nonrouting_cbits.at(TileType::IPCON);
+      FuncCBits ipcon_func_cbits = chipdb->func_cbits(TileType::IPCON);
       for(int lc_idx = 0; lc_idx < 8; lc_idx++) {
         const auto &cbits = ipcon_func_cbits.at(fmt("LC_" << lc_idx));
         static std::vector<int> ipc_lut_perm = {
@@ -2154,9 +2165,9 @@ Placer::configure()
     }
   
   // set RamConfig.PowerUp configuration bit
-  if (chipdb->tile_nonrouting_cbits.count(TileType::RAMB))
+  if (contains_key(chipdb->tile_func_cbits, TileType::RAMB))
     {
-      const CBit &powerup = (chipdb->tile_nonrouting_cbits.at(TileType::RAMB)
+      const CBit &powerup = (chipdb->func_cbits(TileType::RAMB)
                              .at("RamConfig.PowerUp")
                              [0]);
       for (int t : ramt_tiles)
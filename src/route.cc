@@ -22,7 +22,9 @@
 #include "bitvector.hh"
 #include "ullmanset.hh"
 #include "priorityq.hh"
+#include "routestore.hh"
 #include "designstate.hh"
+#include "route.hh"
 
 #include <cassert>
 #include <ostream>
@@ -32,10 +34,43 @@
 #include <set>
 #include <map>
 #include <vector>
+#include <algorithm>
+#include <initializer_list>
 #include <ctime>
+#include <chrono>
+#include <thread>
+#include <functional>
 
 class Router;
 
+// Timing-driven cost is kept in integer units of 1/td_scale of a hop.
+// Delay is normalized by td_ref_delay, roughly the delay of one hop.
+static const int td_scale = 16;
+static const double td_ref_delay = 300.0;
+static const float td_max_crit = 0.99f;
+
+// iCE40 logic cell, ps
+static const int lc_in_lcout_delay[4] = { 449, 400, 379, 316 };
+static const int lc_in1_cout_delay = 259;
+static const int lc_in2_cout_delay = 231;
+static const int lc_cin_cout_delay = 126;
+static const int lc_clk_q_delay = 540;
+static const int lc_setup_delay = 470;
+
+class TimingArc
+{
+public:
+  int from, to;
+  int delay;
+  // routed sink (net, target index) whose delay this arc carries, or
+  // -1.
+  int net, target;
+  
+  TimingArc(int from_, int to_, int delay_, int net_, int target_)
+    : from(from_), to(to_), delay(delay_), net(net_), target(target_)
+  {}
+};
+
 class Comp
 {
 public:
@@ -52,20 +87,22 @@ public:
 
 class Router
 {
+  random_generator &rg;
   const ChipDB *chipdb;
+  const RoutingGraph &graph;
   Design *d;
   Models &models;
   const std::map<Instance *, int, IdLess> &placement;
   std::vector<Net *> &cnet_net;
   Configuration &conf;
   
-  BitVector cnet_global,
-    cnet_local;
-  std::vector<std::vector<int>> cnet_outs;
-  
   std::map<std::string, std::pair<std::string, bool>> ram_gate_chip;
   std::map<std::string, std::string> pll_gate_chip;
   
+  // for LC, IO and GB models, index of each port (by position in
+  // ordered_ports) into cell_type_ports, or -1
+  std::map<Model *, std::vector<int>, IdLess> model_port_idx;
+  
   std::vector<std::vector<int>> cnet_tiles;
   // cnet_bbox
   std::vector<int> cnet_xmin,
@@ -77,20 +114,97 @@ class Router
   std::vector<int> net_source;
   std::vector<std::vector<int>> net_targets;
   std::vector<Net *> net_net;
+  // net pin bbox
+  std::vector<int> net_xmin,
+    net_xmax,
+    net_ymin,
+    net_ymax;
+  std::vector<int> net_bb_margin;
+  std::vector<std::vector<Port *>> net_target_ports;
+  
+  RouteNetOrder net_order_kind;
+  std::vector<int> net_order;
+  int high_fanout;
+  const Configuration *warm_start_conf;
   
   int max_passes;
+  int stall_passes;
+  int bb_margin;
   int passes;
   
+  // timing
+  bool timing_driven;
+  // per net, parallel to net_targets
+  std::vector<std::vector<int>> net_target_delay;  // ps
+  std::vector<std::vector<float>> net_target_crit;
+  int n_timing_nodes;
+  std::vector<int> timing_start_arrival;
+  std::vector<TimingArc> timing_arcs;
+  std::vector<std::vector<int>> timing_node_in_arcs;
+  std::vector<std::vector<int>> timing_node_out_arcs;
+  std::vector<int> timing_order;
+  int critical_path_delay;
+  
+  // --route-stats, reset every pass
+  std::ostream *stats;
+  std::ostream *utilization;
+  bool heatmap;
+  int stats_rerouted;
+  long stats_pushes,
+    stats_pops,
+    stats_expanded;
+  int stats_max_frontier;
+  // --route-threads: speculative routes, and those kept
+  long stats_spec,
+    stats_spec_kept;
+  
   int n_shared;
   std::vector<int> demand;
+  // nodes with demand > 1
+  UllmanSet overused;
+  // number of overused nodes on the route of net n
+  std::vector<int> net_n_overused;
   std::vector<int> historical_demand;
-  std::vector<std::vector<std::pair<int, int>>> net_route;
+  // number of passes that ended with node i overused
+  std::vector<int> contested_passes;
+  // routes of the nets, and the nets using each node
+  RouteStore net_route;
+  // nodes of the branch traceback last added, sink first
+  std::vector<int> branch;
+  
+  // --route-threads, see reroute_parallel.  workers are copies of
+  // this router that route nets speculatively.
+  int n_threads;
+  std::vector<Router *> workers;
+  // nets rerouted by the last batch, which workers have yet to copy
+  std::vector<int> batch_rerouted;
+  // nodes whose demand changed in the current batch
+  UllmanSet dirty;
+  // in a worker: the net last routed speculatively, or -1, and the
+  // nodes whose demand routing it read
+  int spec_net;
+  bool record_reads;
+  mutable UllmanSet reads;
   
   // per net
   int current_net;
   UllmanSet unrouted;
   
+  // timing-driven: sink being routed
+  int current_target;
+  float current_crit;
+  // ps, from the source along the route of current_net
+  std::vector<int> route_delay;
+  
+  // search window
+  int window_xmin,
+    window_xmax,
+    window_ymin,
+    window_ymax;
+  
   UllmanSet visited;
+  // nodes on the route of the net being routed (global fast path)
+  UllmanSet net_tree;
   
   UllmanSet frontier;
   // cn, cost[cn]
@@ -99,12 +213,68 @@ class Router
   std::vector<int> backptr;
   std::vector<int> cost;
   
+  // A*: while astar is set, nodes are queued by cost plus the
+  // lookahead estimate from the node's bounding box to the sinks'.
+  // Only searches of route_net use it, and only if use_astar.
+  bool use_astar;
+  bool astar;
+  int target_xmin,
+    target_xmax,
+    target_ymin,
+    target_ymax;
+  
+  // bidirectional search for two-pin nets: backward wavefront from
+  // the sink.  cost_b[cn] is the cost of the path from cn to the
+  // sink excluding cn, fwdptr[cn] the next node on it.  Only used
+  // if use_bidir.
+  bool use_bidir;
+  bool bidir;
+  UllmanSet visited_b;
+  UllmanSet frontier_b;
+  PriorityQ<std::pair<int, int>, Comp> frontierq_b;
+  std::vector<int> fwdptr;
+  std::vector<int> cost_b;
+  // best meeting edge found so far
+  int meet_from, meet_to, meet_cost;
+  
+  void set_window(int net);
+  bool widen_window(int net);
+  void build_timing_graph();
+  void estimate_delays();
+  void analyze_timing();
+  void select_target(int net);
+  int timing_cost(int cn, int cong_cost) const;
+  int congestion_cost(int cn) const;
+  int node_cost(int cn) const;
+  bool in_window(int cn) const;
+  void set_astar_targets();
+  int lookahead(int cn) const;
+  bool route_global_net(int net);
   void start(int net);
   int pop();
   void visit(int cn);
+  void update_meet(int from, int to, int c);
+  int pop_backward();
+  void visit_backward(int cn);
+  bool route_two_pin(int net);
+  void add_route_node(int net, int prev, int cn);
   void ripup(int net);
   void traceback(int net, int target);
+  void write_pass_stats(double pass_time);
+  void report_utilization();
+  void report_contested();
+  bool net_congested(int net) const;
+  bool reroute_due(int net) const;
+  void route_net(int net);
+  void copy_route(const Router &from, int net);
+  void speculate(const Router &master, int net);
+  bool reads_dirty(const UllmanSet &changed) const;
+  void reroute_parallel();
+  void order_nets();
+  void pre_route_high_fanout();
+  void warm_start(const Configuration &prev_conf);
   
+  void add_model_port_idx(Model *model, CellType type);
   int port_cnet(Instance *inst, Port *p);
 
 #ifndef NDEBUG
@@ -112,16 +282,46 @@ class Router
 #endif
   
 public:
-  Router(DesignState &ds, int max_passes_v);
+  Router(random_generator &rg_, DesignState &ds, const RouteOptions &opts);
   
   void route();
 };
 
+void
+Router::add_model_port_idx(Model *model, CellType type)
+{
+  if (!model)
+    return;
+  
+  const auto &ports = cell_type_ports(type);
+  std::vector<int> &idx = model_port_idx[model];
+  for (Port *p : model->ordered_ports())
+    {
+      auto i = std::find(ports.begin(), ports.end(), p->name());
+      idx.push_back(i == ports.end() ? -1 : (int)(i - ports.begin()));
+    }
+}
+
 int
 Router::port_cnet(Instance *inst, Port *p)
 {
-  const auto &p_name = p->name();
   int cell = placement.at(inst);
+  
+  auto mi = model_port_idx.find(inst->instance_of());
+  if (mi != model_port_idx.end())
+    {
+      assert(p->node() == inst);
+      int i = mi->second[p->index()];
+      if (i >= 0)
+        {
+          int n = chipdb->cell_port_net()[cell][i];
+          if (n >= 0)
+            return n;
+        }
+    }
+  
+  // slow path for everything else, including ports without a net
+  const auto &p_name = p->name();
   const Location &loc = chipdb->cell_location[cell];
   int t = loc.tile();
   
@@ -158,7 +358,7 @@ Router::port_cnet(Instance *inst, Port *p)
           assert(p_name == "O");
           tile_net_name = fmt("lutff_" << loc.pos() << "/out");
         }
-      if (chipdb->tile_nets[t].find(tile_net_name) == chipdb->tile_nets[t].end())
+      if (chipdb->tile_net(t, tile_net_name) < 0)
       {
         fatal(fmt("failed to rote:  " << p->name() << " to " << tile_net_name));
       }
@@ -235,7 +435,7 @@ Router::port_cnet(Instance *inst, Port *p)
       tile_net_name = r.first;
       
       // FIXME if (r.second)
-      if (!contains(chipdb->tile_nets[t], tile_net_name))
+      if (chipdb->tile_net(t, tile_net_name) < 0)
         t = chipdb->tile(chipdb->tile_x(loc.tile()),
                          chipdb->tile_y(loc.tile()) - 1);
     }
@@ -313,7 +513,8 @@ Router::port_cnet(Instance *inst, Port *p)
 #endif
     }
   
-  int n = chipdb->tile_nets[t].at(tile_net_name);
+  int n = chipdb->tile_net(t, tile_net_name);
+  assert(n >= 0);
   return n;
 }
 
@@ -335,72 +536,91 @@ Router::check()
         ++n_shared2;
     }
   assert(n_shared2 == n_shared);
+  assert((int)overused.size() == n_shared);
+  
+  for (int i = 0; i < n_nets; ++i)
+    {
+      int n_overused2 = 0;
+      for (const auto &p : net_route[i])
+        {
+          if (demand[p.second] > 1)
+            ++n_overused2;
+        }
+      assert(n_overused2 == net_n_overused[i]);
+    }
 }
 #endif
 
-Router::Router(DesignState &ds, int max_passes_v)
-  : chipdb(ds.chipdb),
+Router::Router(random_generator &rg_, DesignState &ds, const RouteOptions &opts)
+  : rg(rg_),
+    chipdb(ds.chipdb),
+    graph(chipdb->routing_graph()),
     d(ds.d),
     models(ds.models),
     placement(ds.placement),
     cnet_net(ds.cnet_net),
     conf(ds.conf),
-    cnet_global(chipdb->n_nets),
-    cnet_local(chipdb->n_nets),
-    cnet_outs(chipdb->n_nets),
     cnet_tiles(chipdb->n_nets),
     cnet_xmin(chipdb->n_nets),
     cnet_xmax(chipdb->n_nets),
     cnet_ymin(chipdb->n_nets),
     cnet_ymax(chipdb->n_nets),
     n_nets(0),
-    max_passes(max_passes_v),
+    net_order_kind(opts.net_order),
+    high_fanout(opts.high_fanout),
+    warm_start_conf(opts.warm_start),
+    max_passes(opts.max_passes),
+    stall_passes(opts.stall_passes),
+    bb_margin(opts.bb_margin),
+    timing_driven(opts.timing_driven),
+    n_timing_nodes(0),
+    critical_path_delay(0),
+    stats(opts.stats),
+    utilization(opts.utilization),
+    heatmap(opts.heatmap),
+    stats_rerouted(0),
+    stats_pushes(0),
+    stats_pops(0),
+    stats_expanded(0),
+    stats_max_frontier(0),
+    stats_spec(0),
+    stats_spec_kept(0),
     n_shared(0),
     demand(chipdb->n_nets, 0),
+    overused(chipdb->n_nets),
     historical_demand(chipdb->n_nets, 0),
+    contested_passes(chipdb->n_nets, 0),
+    net_route(chipdb->n_nets),
+    n_threads(opts.threads),
+    spec_net(-1),
+    record_reads(false),
     unrouted(chipdb->n_nets),
+    current_target(-1),
+    current_crit(0),
+    route_delay(chipdb->n_nets, 0),
     visited(chipdb->n_nets),
+    net_tree(chipdb->n_nets),
     frontier(chipdb->n_nets),
     backptr(chipdb->n_nets),
-    cost(chipdb->n_nets)
+    cost(chipdb->n_nets),
+    use_astar(opts.astar),
+    astar(false),
+    target_xmin(0),
+    target_xmax(0),
+    target_ymin(0),
+    target_ymax(0),
+    use_bidir(opts.bidir),
+    bidir(false),
+    visited_b(chipdb->n_nets),
+    frontier_b(chipdb->n_nets),
+    fwdptr(chipdb->n_nets),
+    cost_b(chipdb->n_nets),
+    meet_from(-1),
+    meet_to(-1),
+    meet_cost(0)
 {
   cnet_net = std::vector<Net *>(chipdb->n_nets, nullptr);
   
-  for (int t = 0; t < chipdb->n_tiles; ++t)
-    {
-      for (const auto &p : chipdb->tile_nets[t])
-        {
-          if (is_prefix("local_", p.first))
-            {
-              if (!cnet_local[p.second])
-                {
-                  cnet_local[p.second] = true;
-                  break;
-                }
-            }
-          else if (is_prefix("glb_netwk_", p.first))
-            {
-              if (!cnet_global[p.second])
-                {
-                  cnet_global[p.second] = true;
-                  break;
-                }
-            }
-        }
-    }
-  
-  for (int i = 0; i < chipdb->n_nets; ++i)
-    {
-      for (int s : chipdb->in_switches[i])
-        {
-          assert(contains_key(chipdb->switches[s].in_val, i));
-          int j = chipdb->switches[s].out;
-          assert(j != i);
-          
-          cnet_outs[i].push_back(j);
-        }
-    }
-  
   for (int i = 0; i <= 7; ++i)
     extend(ram_gate_chip,
            fmt("RDATA[" << i << "]"),
@@ -501,8 +721,15 @@ Router::Router(DesignState &ds, int max_passes_v)
   extend(pll_gate_chip, "PLLOUTCOREA", "PLLOUT_A");
   extend(pll_gate_chip, "PLLOUTCOREB", "PLLOUT_B");
   
+  add_model_port_idx(models.lc, CellType::LOGIC);
+  add_model_port_idx(models.io, CellType::IO);
+  add_model_port_idx(models.gb_io, CellType::IO);
+  add_model_port_idx(models.io_i3c, CellType::IO);
+  add_model_port_idx(models.io_od, CellType::IO);
+  add_model_port_idx(models.gb, CellType::GB);
+  
   for (int t = 0; t < chipdb->n_tiles; ++t)
-    for (const auto &p : chipdb->tile_nets[t])
+    for (const auto &p : chipdb->tile_nets()[t])
       cnet_tiles[p.second].push_back(t);
   
   for (int i = 0; i < chipdb->n_nets; ++i)
@@ -527,6 +754,38 @@ Router::Router(DesignState &ds, int max_passes_v)
     }
 }
 
+void
+Router::set_window(int net)
+{
+  int m = net_bb_margin[net];
+  if (!m)
+    {
+      window_xmin = 0;
+      window_xmax = chipdb->width - 1;
+      window_ymin = 0;
+      window_ymax = chipdb->height - 1;
+      return;
+    }
+  window_xmin = net_xmin[net] - m;
+  window_xmax = net_xmax[net] + m;
+  window_ymin = net_ymin[net] - m;
+  window_ymax = net_ymax[net] + m;
+}
+
+bool
+Router::widen_window(int net)
+{
+  if (window_xmin <= 0
+      && window_xmax >= chipdb->width - 1
+      && window_ymin <= 0
+      && window_ymax >= chipdb->height - 1)
+    return false;
+  
+  net_bb_margin[net] = net_bb_margin[net] * 2 + 1;
+  set_window(net);
+  return true;
+}
+
 void
 Router::start(int net)
 {
@@ -544,36 +803,203 @@ Router::start(int net)
     {
       frontier.erase(p.second);
       
-      cost[p.second] = 0;
+      if (timing_driven)
+        cost[p.second] = (int)(current_crit * route_delay[p.second]
+                               / td_ref_delay * td_scale);
+      else
+        cost[p.second] = 0;
       backptr[p.second] = -1;
       visit(p.second);
     }
 }
 
+int
+Router::congestion_cost(int cn) const
+{
+  if (record_reads)
+    reads.insert(cn);
+  
+  int c = graph.net_base_cost[cn];
+  if (passes == max_passes)
+    return demand[cn] ? 1000000 : c;
+  else // if (passes > 1)
+    return (c + historical_demand[cn]) * (1 + 3 * demand[cn]);
+}
+
+int
+Router::node_cost(int cn) const
+{
+  int c = congestion_cost(cn);
+  if (timing_driven
+      && !(passes == max_passes && demand[cn]))
+    c = timing_cost(cn, c);
+  return c;
+}
+
+bool
+Router::in_window(int cn) const
+{
+  return (cnet_xmax[cn] >= window_xmin
+          && cnet_xmin[cn] <= window_xmax
+          && cnet_ymax[cn] >= window_ymin
+          && cnet_ymin[cn] <= window_ymax);
+}
+
 void
-Router::visit(int cn)
+Router::set_astar_targets()
 {
-  assert(!frontier.contains(cn));
-  visited.extend(cn);
+  if (timing_driven)
+    {
+      target_xmin = cnet_xmin[current_target];
+      target_xmax = cnet_xmax[current_target];
+      target_ymin = cnet_ymin[current_target];
+      target_ymax = cnet_ymax[current_target];
+      return;
+    }
   
-  for (int cn2 : cnet_outs[cn])
+  assert(!unrouted.empty());
+  int cn = unrouted.ith(0);
+  target_xmin = cnet_xmin[cn];
+  target_xmax = cnet_xmax[cn];
+  target_ymin = cnet_ymin[cn];
+  target_ymax = cnet_ymax[cn];
+  for (int k = 1; k < (int)unrouted.size(); ++k)
     {
-      if (visited.contains(cn2))
+      cn = unrouted.ith(k);
+      target_xmin = std::min(target_xmin, cnet_xmin[cn]);
+      target_xmax = std::max(target_xmax, cnet_xmax[cn]);
+      target_ymin = std::min(target_ymin, cnet_ymin[cn]);
+      target_ymax = std::max(target_ymax, cnet_ymax[cn]);
+    }
+}
+
+int
+Router::lookahead(int cn) const
+{
+  if (!astar)
+    return 0;
+  
+  int dx = std::max(0, std::max(target_xmin - cnet_xmax[cn],
+                                cnet_xmin[cn] - target_xmax)),
+    dy = std::max(0, std::max(target_ymin - cnet_ymax[cn],
+                              cnet_ymin[cn] - target_ymax));
+  int c = graph.lookahead_cost(graph.net_span_type[cn], dx, dy);
+  if (timing_driven)
+    c = (int)((1.0f - current_crit) * td_scale * c);
+  return c;
+}
+
+bool
+Router::route_global_net(int net)
+{
+  int source = net_source[net];
+  net_tree.clear();
+  net_tree.insert(source);
+  
+  for (int target : net_targets[net])
+    {
+      if (net_tree.contains(target))
         continue;
       
-      int cn2_cost = 1;  // base
-      if (passes == max_passes)
+      // The global reaches every tile through its column buffer, so
+      // a sink is fed by it directly (clk, cen, s_r) or through at
+      // most two nodes of the sink's tile (glb2local, then local_g).
+      // Try each such path from the net's tree, nodes already on it
+      // being free, and take the cheapest.  best[0 .. best_n - 1]
+      // leads from the tree to the sink.
+      int t = graph.net_tile[target];
+      auto local = [this, t](int cn) {
+        return cnet_tiles[cn].size() == 1 && cnet_tiles[cn][0] == t;
+      };
+      
+      int best[4],
+        best_n = 0,
+        best_cost = 0;
+      auto consider = [&](std::initializer_list<int> path, int c) {
+        if (best_n == 0 || c < best_cost)
+          {
+            best_n = 0;
+            for (int cn : path)
+              best[best_n++] = cn;
+            best_cost = c;
+          }
+      };
+      
+      for (int e1 = graph.in_begin[target]; e1 < graph.in_begin[target + 1]; ++e1)
+        {
+          int n1 = graph.in_net[e1];
+          ++stats_expanded;
+          if (net_tree.contains(n1))
+            {
+              consider({n1, target}, 0);
+              continue;
+            }
+          if (!local(n1))
+            continue;
+          
+          int c1 = congestion_cost(n1);
+          for (int e2 = graph.in_begin[n1]; e2 < graph.in_begin[n1 + 1]; ++e2)
+            {
+              int n2 = graph.in_net[e2];
+              ++stats_expanded;
+              if (net_tree.contains(n2))
+                {
+                  consider({n2, n1, target}, c1);
+                  continue;
+                }
+              if (!local(n2))
+                continue;
+              
+              int c2 = c1 + congestion_cost(n2);
+              for (int e3 = graph.in_begin[n2]; e3 < graph.in_begin[n2 + 1]; ++e3)
+                {
+                  int n3 = graph.in_net[e3];
+                  if (net_tree.contains(n3))
+                    consider({n3, n2, n1, target}, c2);
+                }
+            }
+        }
+      
+      if (best_n == 0)
         {
-          if (demand[cn2])
-            cn2_cost = 1000000;
+          ripup(net);
+          return false;
         }
-      else // if (passes > 1)
+      
+      for (int i = 0; i + 1 < best_n; ++i)
         {
-          cn2_cost += historical_demand[cn2];
-          cn2_cost *= (1 + 3 * demand[cn2]);
+          add_route_node(net, best[i], best[i + 1]);
+          net_tree.insert(best[i + 1]);
+          route_delay[best[i + 1]] = (route_delay[best[i]]
+                                      + graph.net_delay[best[i + 1]]);
         }
+    }
+  
+  return true;
+}
+
+void
+Router::visit(int cn)
+{
+  assert(!frontier.contains(cn));
+  visited.extend(cn);
+  ++stats_expanded;
+  
+  for (int e = graph.out_begin[cn]; e < graph.out_begin[cn + 1]; ++e)
+    {
+      int cn2 = graph.out_net[e];
+      if (visited.contains(cn2))
+        continue;
+      
+      if (!in_window(cn2))
+        continue;
+      
+      int new_cost = cost[cn] + node_cost(cn2);
       
-      int new_cost = cost[cn] + cn2_cost;
+      if (bidir
+          && (frontier_b.contains(cn2)
+              || visited_b.contains(cn2)))
+        update_meet(cn, cn2, new_cost + cost_b[cn2]);
       
       if (frontier.contains(cn2))
         {
@@ -586,7 +1012,8 @@ Router::visit(int cn)
 #endif
               cost[cn2] = new_cost;
               backptr[cn2] = cn;
-              frontierq.push(std::make_pair(cn2, new_cost));
+              frontierq.push(std::make_pair(cn2, new_cost + lookahead(cn2)));
+              ++stats_pushes;
             }
         }
       else
@@ -598,7 +1025,10 @@ Router::visit(int cn)
                     << " cost " << new_cost << "\n";
 #endif
           frontier.insert(cn2);
-          frontierq.push(std::make_pair(cn2, new_cost));
+          frontierq.push(std::make_pair(cn2, new_cost + lookahead(cn2)));
+          ++stats_pushes;
+          stats_max_frontier = std::max(stats_max_frontier,
+                                        (int)frontier.size());
         }
     }
 }
@@ -610,11 +1040,12 @@ Router::pop()
   assert(!frontierq.empty());
   int cn, cn_cost;
   std::tie(cn, cn_cost) = frontierq.pop();
+  ++stats_pops;
   if (!frontier.contains(cn))
     goto L;
   
   // *logs << "pop " << cn << "\n";
-  assert(cn_cost == cost[cn]);
+  assert(cn_cost == cost[cn] + lookahead(cn));
   assert(frontierq.empty()
          || cn_cost <= frontierq.top().second);
   
@@ -623,6 +1054,150 @@ Router::pop()
   return cn;
 }
 
+void
+Router::update_meet(int from, int to, int c)
+{
+  if (meet_from < 0
+      || c < meet_cost)
+    {
+      meet_from = from;
+      meet_to = to;
+      meet_cost = c;
+    }
+}
+
+int
+Router::pop_backward()
+{
+ L:
+  assert(!frontierq_b.empty());
+  int cn, cn_cost;
+  std::tie(cn, cn_cost) = frontierq_b.pop();
+  ++stats_pops;
+  if (!frontier_b.contains(cn))
+    goto L;
+  
+  assert(cn_cost == cost_b[cn]);
+  frontier_b.erase(cn);
+  
+  return cn;
+}
+
+void
+Router::visit_backward(int cn)
+{
+  assert(!frontier_b.contains(cn));
+  visited_b.extend(cn);
+  ++stats_expanded;
+  
+  // every fanin edge of cn costs the same
+  int new_cost = cost_b[cn] + node_cost(cn);
+  for (int e = graph.in_begin[cn]; e < graph.in_begin[cn + 1]; ++e)
+    {
+      int prev = graph.in_net[e];
+      if (visited_b.contains(prev))
+        continue;
+      
+      if (!in_window(prev))
+        continue;
+      
+      if (frontier.contains(prev)
+          || visited.contains(prev))
+        update_meet(prev, cn, cost[prev] + new_cost);
+      
+      if (frontier_b.contains(prev))
+        {
+          if (new_cost >= cost_b[prev])
+            continue;
+        }
+      else
+        frontier_b.insert(prev);
+      cost_b[prev] = new_cost;
+      fwdptr[prev] = cn;
+      frontierq_b.push(std::make_pair(prev, new_cost));
+      ++stats_pushes;
+      stats_max_frontier = std::max(stats_max_frontier,
+                                    (int)(frontier.size() + frontier_b.size()));
+    }
+}
+
+// Route a net with a single sink by growing wavefronts from both
+// ends, always expanding the smaller one.  Stops once the two queue
+// minima add up to at least the best meeting cost found, at which
+// point no cheaper path can exist.  Returns false if the ends are not
+// connected inside the window.
+bool
+Router::route_two_pin(int net)
+{
+  assert(net_targets[net].size() == 1);
+  assert(net_route[net].empty());
+  int target = net_targets[net][0];
+  
+  if (timing_driven)
+    select_target(net);
+  
+  bidir = true;
+  meet_from = -1;
+  meet_to = -1;
+  visited_b.clear();
+  frontier_b.clear();
+  frontierq_b.clear();
+  cost_b[target] = 0;
+  fwdptr[target] = -1;
+  frontier_b.insert(target);
+  frontierq_b.push(std::make_pair(target, 0));
+  
+  start(net);
+  while (!frontier.empty()
+         && !frontier_b.empty())
+    {
+      // queue tops may be stale, but are never above the true minima
+      if (meet_from >= 0
+          && frontierq.top().second + frontierq_b.top().second >= meet_cost)
+        break;
+      
+      if (frontier.size() <= frontier_b.size())
+        visit(pop());
+      else
+        visit_backward(pop_backward());
+    }
+  bidir = false;
+  
+  if (meet_from < 0)
+    return false;
+  
+  // the forward half, from the source to meet_from
+  traceback(net, meet_from);
+  
+  for (int cn = meet_from, next = meet_to; next >= 0; )
+    {
+      add_route_node(net, cn, next);
+      route_delay[next] = route_delay[cn] + graph.net_delay[next];
+      cn = next;
+      next = fwdptr[cn];
+    }
+  
+  return true;
+}
+
+void
+Router::add_route_node(int net, int prev, int cn)
+{
+  if (record_reads)
+    reads.insert(cn);
+  net_route.add(net, prev, cn);
+  ++demand[cn];
+  if (demand[cn] == 2)
+    {
+      ++n_shared;
+      overused.extend(cn);
+      for (int n2 : net_route.node_nets(cn))
+        ++net_n_overused[n2];
+    }
+  else if (demand[cn] > 2)
+    ++net_n_overused[net];
+}
+
 void
 Router::ripup(int net)
 {
@@ -631,85 +1206,1050 @@ Router::ripup(int net)
       int cn = p.second;
       --demand[cn];
       if (demand[cn] == 1)
-        --n_shared;
+        {
+          --n_shared;
+          overused.erase(cn);
+          for (int n2 : net_route.node_nets(cn))
+            {
+              if (n2 != net)
+                {
+                  --net_n_overused[n2];
+                  break;
+                }
+            }
+        }
     }
-  net_route[net].clear();
+  net_route.clear(net);
+  net_n_overused[net] = 0;
 }
 
 void
 Router::traceback(int net, int target)
 {
+  branch.clear();
   int cn = target;
   while (cn >= 0)
     {
       int prev = backptr[cn];
       if (prev >= 0)
         {
-          if (demand[cn] == 1)
-            ++n_shared;
-          ++demand[cn];
-          net_route[net].push_back(std::make_pair(prev, cn));
+          add_route_node(net, prev, cn);
+          branch.push_back(cn);
         }
       cn = prev;
     }
+  
+  if (timing_driven)
+    {
+      // from the tree out to the target
+      for (int j = (int)branch.size() - 1; j >= 0; --j)
+        {
+          int cn2 = branch[j];
+          route_delay[cn2] = route_delay[backptr[cn2]] + graph.net_delay[cn2];
+        }
+    }
 }
 
 void
-Router::route()
+Router::write_pass_stats(double pass_time)
 {
-  // d->dump();
+  std::vector<int> n_overused(static_cast<int>(SpanType::GLOBAL) + 1, 0);
+  std::map<int, int> tile_overuse;
+  for (int k = 0; k < (int)overused.size(); ++k)
+    {
+      int i = overused.ith(k);
+      ++n_overused[static_cast<int>(graph.net_span_type[i])];
+      tile_overuse[graph.net_tile[i]] += demand[i] - 1;
+    }
   
-  Model *top = d->top();
+  *stats << "pass " << passes << "\n"
+         << "  time " << std::fixed << std::setprecision(3) << pass_time << "s\n"
+         << "  nets rerouted " << stats_rerouted << "\n"
+         << "  heap pushes " << stats_pushes << ", pops " << stats_pops << "\n"
+         << "  nodes expanded " << stats_expanded << "\n"
+         << "  max frontier " << stats_max_frontier << "\n";
+  if (n_threads > 1)
+    *stats << "  speculative routes kept " << stats_spec_kept
+           << " of " << stats_spec << "\n";
+  *stats << "  overused nodes " << n_shared << ":";
+  for (SpanType st : {SpanType::LOCAL, SpanType::SPAN4, SpanType::SPAN12,
+        SpanType::GLOBAL, SpanType::OTHER})
+    *stats << " " << span_type_name(st) << " " << n_overused[static_cast<int>(st)];
+  *stats << "\n";
   
-  std::set<Net *, IdLess> boundary_nets = top->boundary_nets(d);
-  for (const auto &p : top->nets())
+  if (!tile_overuse.empty())
     {
-      Net *n = p.second;
-      if (contains(boundary_nets, n))
-        continue;
+      std::vector<std::pair<int, int>> tiles;  // overuse, tile
+      for (const auto &p : tile_overuse)
+        tiles.push_back(std::make_pair(p.second, p.first));
+      std::sort(tiles.begin(), tiles.end(),
+                [](const std::pair<int, int> &a, const std::pair<int, int> &b) {
+                  return (a.first > b.first
+                          || (a.first == b.first && a.second < b.second));
+                });
+      if (tiles.size() > 10)
+        tiles.resize(10);
       
-#ifndef NDEBUG
-      if (n->is_constant())
-        {
-          Value v = n->constant();
-          assert(v == Value::ZERO || v == Value::ONE);
-          
-          for (auto p2 : n->connections())
+      std::map<int, std::set<Net *, IdLess>> tile_nets;
+      for (const auto &p : tiles)
+        tile_nets[p.second];
+      for (int i = 0; i < n_nets; ++i)
+        for (const auto &p : net_route[i])
+          if (demand[p.second] > 1)
             {
-              Instance *inst = cast<Instance>(p2->node());
-              
-              if (models.is_lc(inst)
-                  && p2->name() == "CIN")
-                {
-                  int cell = placement.at(inst);
-                  const Location &loc = chipdb->cell_location[cell];
-                  if (loc.pos() == 0)
-                    continue;
-                }
-              
-              assert(p2->is_input()
-                     && !p2->is_bidir()
-                     && p2->undriven() == v);
+              auto j = tile_nets.find(graph.net_tile[p.second]);
+              if (j != tile_nets.end())
+                j->second.insert(net_net[i]);
             }
-        }
-#endif
-      
-      int source = -1;
-      std::vector<int> targets;
       
-      // *logs << n->name() << "\n";
-      
-      for (auto p2 : n->connections())
+      *stats << "  congested tiles:\n";
+      for (const auto &p : tiles)
         {
-          assert(p2->connection() == n);
-          assert(isa<Instance>(p2->node()));
-          
-          Instance *inst = cast<Instance>(p2->node());
-          int cn = port_cnet(inst, p2);
-          
-          // like lutff_i/cin
-          if (cn < 0)
-            continue;
+          int t = p.second;
+          *stats << "    " << chipdb->tile_x(t) << " " << chipdb->tile_y(t)
+                 << ": overuse " << p.first << ", nets";
+          for (Net *n : tile_nets.at(t))
+            *stats << " " << n->name();
+          *stats << "\n";
+        }
+    }
+  
+  stats->flush();
+}
+
+void
+Router::report_utilization()
+{
+  // per tile, indexed by SpanType
+  const int n_span_types = static_cast<int>(SpanType::GLOBAL) + 1;
+  std::vector<std::vector<int>> tile_used(chipdb->n_tiles,
+                                          std::vector<int>(n_span_types, 0)),
+    tile_total(chipdb->n_tiles,
+               std::vector<int>(n_span_types, 0));
+  
+  for (int i = 0; i < chipdb->n_nets; ++i)
+    {
+      int st = static_cast<int>(graph.net_span_type[i]);
+      for (int t : cnet_tiles[i])
+        {
+          ++tile_total[t][st];
+          if (demand[i])
+            ++tile_used[t][st];
+        }
+    }
+  
+  // global nets are never route nodes; count the globals driving
+  // something in each tile
+  std::set<std::pair<int, int>> tile_global;
+  for (int i = 0; i < n_nets; ++i)
+    for (const auto &p : net_route[i])
+      {
+        if (chipdb->net_global()[p.first] >= 0)
+          tile_global.insert(std::make_pair(graph.net_tile[p.second], p.first));
+      }
+  for (const auto &p : tile_global)
+    ++tile_used[p.first][static_cast<int>(SpanType::GLOBAL)];
+  
+  // the placer's view: each net's half-perimeter wire length spread
+  // evenly over its pin bounding box
+  std::vector<double> tile_placer_demand(chipdb->n_tiles, 0.0);
+  for (int n = 0; n < n_nets; ++n)
+    {
+      if (chipdb->net_global()[net_source[n]] >= 0)
+        continue;
+      int w = net_xmax[n] - net_xmin[n] + 1,
+        h = net_ymax[n] - net_ymin[n] + 1;
+      double pd = (double)(w - 1 + h - 1) / (double)(w * h);
+      for (int x = net_xmin[n]; x <= net_xmax[n]; ++x)
+        for (int y = net_ymin[n]; y <= net_ymax[n]; ++y)
+          tile_placer_demand[chipdb->tile(x, y)] += pd;
+    }
+  
+  static const SpanType span_types[] = {
+    SpanType::LOCAL, SpanType::SPAN4, SpanType::SPAN12, SpanType::GLOBAL,
+  };
+  
+  if (utilization)
+    {
+      *utilization << "x,y,type";
+      for (SpanType st : span_types)
+        *utilization << "," << span_type_name(st) << "_used,"
+                     << span_type_name(st) << "_total";
+      *utilization << ",placer_demand\n";
+      
+      for (int t = 0; t < chipdb->n_tiles; ++t)
+        {
+          TileType ty = chipdb->tile_type[t];
+          *utilization << chipdb->tile_x(t) << "," << chipdb->tile_y(t)
+                       << "," << (ty == TileType::EMPTY
+                                  ? "empty"
+                                  : tile_type_name(ty));
+          for (SpanType st : span_types)
+            *utilization << "," << tile_used[t][static_cast<int>(st)]
+                         << "," << tile_total[t][static_cast<int>(st)];
+          *utilization << "," << std::fixed << std::setprecision(2)
+                       << tile_placer_demand[t] << "\n";
+        }
+    }
+  
+  if (heatmap)
+    {
+      static const char levels[] = " .:-=+*#%@";
+      const int n_levels = sizeof(levels) - 1;
+      
+      double max_placer_demand = 0.0;
+      for (double pd : tile_placer_demand)
+        max_placer_demand = std::max(max_placer_demand, pd);
+      
+      *logs << "\n"
+            << "Routing utilization (local+span4+span12), placer demand:\n"
+            << "  (' ' = 0 .. '@' = max)\n";
+      for (int y = chipdb->height - 1; y >= 0; --y)
+        {
+          *logs << std::setw(4) << y << " ";
+          for (int x = 0; x < chipdb->width; ++x)
+            {
+              int t = chipdb->tile(x, y),
+                used = 0,
+                total = 0;
+              for (SpanType st : {SpanType::LOCAL, SpanType::SPAN4, SpanType::SPAN12})
+                {
+                  used += tile_used[t][static_cast<int>(st)];
+                  total += tile_total[t][static_cast<int>(st)];
+                }
+              int k = total ? used * (n_levels - 1) / total : 0;
+              *logs << levels[k];
+            }
+          *logs << "   ";
+          for (int x = 0; x < chipdb->width; ++x)
+            {
+              double pd = tile_placer_demand[chipdb->tile(x, y)];
+              int k = (max_placer_demand > 0.0
+                       ? (int)(pd * (n_levels - 1) / max_placer_demand)
+                       : 0);
+              *logs << levels[k];
+            }
+          *logs << "\n";
+        }
+    }
+}
+
+int
+Router::timing_cost(int cn, int cong_cost) const
+{
+  double c = ((1.0 - current_crit) * cong_cost
+              + current_crit * graph.net_delay[cn] / td_ref_delay);
+  return std::max(1, (int)(c * td_scale + 0.5));
+}
+
+void
+Router::select_target(int net)
+{
+  const auto &targets = net_targets[net];
+  current_target = -1;
+  for (int i = 0; i < (int)targets.size(); ++i)
+    {
+      if (!unrouted.contains(targets[i]))
+        continue;
+      if (current_target < 0
+          || net_target_crit[net][i] > current_crit)
+        {
+          current_target = targets[i];
+          current_crit = net_target_crit[net][i];
+        }
+    }
+  assert(current_target >= 0);
+}
+
+void
+Router::build_timing_graph()
+{
+  Model *top = d->top();
+  
+  std::map<Port *, std::pair<int, int>, IdLess> port_target;
+  for (int n = 0; n < n_nets; ++n)
+    for (int i = 0; i < (int)net_target_ports[n].size(); ++i)
+      extend(port_target, net_target_ports[n][i], std::make_pair(n, i));
+  
+  // nodes are instance ports, plus one D node per registered logic cell
+  std::map<Port *, int, IdLess> port_node;
+  for (Instance *inst : top->instances())
+    for (const auto &p : inst->ports())
+      {
+        Net *n = p.second->connection();
+        if (n && !n->is_constant())
+          extend(port_node, p.second, n_timing_nodes++);
+      }
+  timing_start_arrival.resize(n_timing_nodes, -1);
+  
+  std::set<Net *, IdLess> boundary_nets = top->boundary_nets(d);
+  for (const auto &p : top->nets())
+    {
+      Net *n = p.second;
+      if (n->is_constant()
+          || contains(boundary_nets, n))
+        continue;
+      
+      Port *driver = nullptr;
+      for (Port *p2 : n->connections())
+        if (p2->is_output())
+          driver = p2;
+      if (!driver)
+        continue;
+      
+      int from = port_node.at(driver);
+      for (Port *p2 : n->connections())
+        {
+          if (p2 == driver)
+            continue;
+          
+          int net = -1, target = -1;
+          auto i = port_target.find(p2);
+          if (i != port_target.end())
+            std::tie(net, target) = i->second;
+          timing_arcs.push_back(TimingArc(from, port_node.at(p2), 0,
+                                          net, target));
+        }
+    }
+  
+  for (Instance *inst : top->instances())
+    {
+      if (!models.is_lc(inst))
+        {
+          for (const auto &p : inst->ports())
+            if (p.second->is_output()
+                && contains_key(port_node, p.second))
+              timing_start_arrival[port_node.at(p.second)] = 0;
+          continue;
+        }
+      
+      bool dff = inst->get_param("DFF_ENABLE").get_bit(0);
+      int d_node = -1;
+      if (dff)
+        d_node = n_timing_nodes++;
+      
+      auto node = [&](const char *name) -> int {
+        Port *p = inst->find_port(name);
+        if (!p)
+          return -1;
+        auto i = port_node.find(p);
+        return i == port_node.end() ? -1 : i->second;
+      };
+      int o = node("O"),
+        lo = node("LO"),
+        cout = node("COUT"),
+        cin = node("CIN");
+      
+      if (dff && o >= 0)
+        timing_start_arrival[o] = lc_clk_q_delay;
+      
+      for (int j = 0; j < 4; ++j)
+        {
+          int in = node(fmt("I" << j).c_str());
+          if (in < 0)
+            continue;
+          int lut = lc_in_lcout_delay[j];
+          if (dff)
+            timing_arcs.push_back(TimingArc(in, d_node, lut + lc_setup_delay, -1, -1));
+          else if (o >= 0)
+            timing_arcs.push_back(TimingArc(in, o, lut, -1, -1));
+          if (lo >= 0)
+            timing_arcs.push_back(TimingArc(in, lo, lut, -1, -1));
+          if (cout >= 0 && j == 1)
+            timing_arcs.push_back(TimingArc(in, cout, lc_in1_cout_delay, -1, -1));
+          if (cout >= 0 && j == 2)
+            timing_arcs.push_back(TimingArc(in, cout, lc_in2_cout_delay, -1, -1));
+        }
+      if (cin >= 0 && cout >= 0)
+        timing_arcs.push_back(TimingArc(cin, cout, lc_cin_cout_delay, -1, -1));
+    }
+  timing_start_arrival.resize(n_timing_nodes, -1);
+  
+  timing_node_in_arcs.resize(n_timing_nodes);
+  timing_node_out_arcs.resize(n_timing_nodes);
+  for (int i = 0; i < (int)timing_arcs.size(); ++i)
+    {
+      timing_node_out_arcs[timing_arcs[i].from].push_back(i);
+      timing_node_in_arcs[timing_arcs[i].to].push_back(i);
+    }
+  
+  // topological order; nodes on combinational loops are appended
+  // in index order
+  std::vector<int> n_in(n_timing_nodes);
+  std::vector<int> ready;
+  for (int i = 0; i < n_timing_nodes; ++i)
+    {
+      n_in[i] = timing_node_in_arcs[i].size();
+      if (!n_in[i])
+        ready.push_back(i);
+    }
+  std::vector<bool> ordered(n_timing_nodes, false);
+  while (!ready.empty())
+    {
+      int v = ready.back();
+      ready.pop_back();
+      ordered[v] = true;
+      timing_order.push_back(v);
+      for (int a : timing_node_out_arcs[v])
+        {
+          int w = timing_arcs[a].to;
+          if (--n_in[w] == 0)
+            ready.push_back(w);
+        }
+    }
+  for (int i = 0; i < n_timing_nodes; ++i)
+    if (!ordered[i])
+      timing_order.push_back(i);
+}
+
+void
+Router::estimate_delays()
+{
+  const int local_delay = span_type_delay(SpanType::LOCAL),
+    other_delay = span_type_delay(SpanType::OTHER),
+    span4_delay = span_type_delay(SpanType::SPAN4);
+  
+  for (int n = 0; n < n_nets; ++n)
+    {
+      int source = net_source[n];
+      const auto &targets = net_targets[n];
+      for (int i = 0; i < (int)targets.size(); ++i)
+        {
+          int cn = targets[i];
+          int dx = std::max(0, std::max(cnet_xmin[cn] - cnet_xmax[source],
+                                        cnet_xmin[source] - cnet_xmax[cn])),
+            dy = std::max(0, std::max(cnet_ymin[cn] - cnet_ymax[source],
+                                      cnet_ymin[source] - cnet_ymax[cn]));
+          net_target_delay[n][i] = (local_delay + other_delay
+                                    + (dx + dy + 3) / 4 * span4_delay);
+        }
+    }
+}
+
+void
+Router::analyze_timing()
+{
+  std::vector<int> arrival(n_timing_nodes, 0);
+  for (int v : timing_order)
+    {
+      int t = std::max(0, timing_start_arrival[v]);
+      for (int a : timing_node_in_arcs[v])
+        {
+          const TimingArc &arc = timing_arcs[a];
+          int delay = arc.delay;
+          if (arc.net >= 0)
+            delay += net_target_delay[arc.net][arc.target];
+          t = std::max(t, arrival[arc.from] + delay);
+        }
+      arrival[v] = t;
+    }
+  
+  critical_path_delay = 0;
+  for (int i = 0; i < n_timing_nodes; ++i)
+    critical_path_delay = std::max(critical_path_delay, arrival[i]);
+  
+  std::vector<int> required(n_timing_nodes, critical_path_delay);
+  for (int k = n_timing_nodes - 1; k >= 0; --k)
+    {
+      int v = timing_order[k];
+      int t = critical_path_delay;
+      for (int a : timing_node_out_arcs[v])
+        {
+          const TimingArc &arc = timing_arcs[a];
+          int delay = arc.delay;
+          if (arc.net >= 0)
+            delay += net_target_delay[arc.net][arc.target];
+          t = std::min(t, required[arc.to] - delay);
+        }
+      required[v] = t;
+    }
+  
+  for (const TimingArc &arc : timing_arcs)
+    {
+      if (arc.net < 0)
+        continue;
+      float crit = 0;
+      if (critical_path_delay > 0)
+        {
+          int slack = (required[arc.to] - arrival[arc.from]
+                       - arc.delay - net_target_delay[arc.net][arc.target]);
+          crit = 1.0f - (float)slack / (float)critical_path_delay;
+          crit = std::max(0.0f, std::min(td_max_crit, crit));
+        }
+      net_target_crit[arc.net][arc.target] = crit;
+    }
+}
+
+// Log the nodes most often left overused at the end of a pass, and
+// the nets fighting over them.
+void
+Router::report_contested()
+{
+  std::vector<int> nodes;
+  for (int i = 0; i < chipdb->n_nets; ++i)
+    {
+      if (contested_passes[i] > 0)
+        nodes.push_back(i);
+    }
+  std::stable_sort(nodes.begin(), nodes.end(),
+                   [this](int a, int b) {
+                     return (contested_passes[a] > contested_passes[b]
+                             || (contested_passes[a] == contested_passes[b]
+                                 && historical_demand[a] > historical_demand[b]));
+                   });
+  if (nodes.size() > 20)
+    nodes.resize(20);
+  
+  std::map<int, std::set<Net *, IdLess>> contested_nets;
+  for (int i : nodes)
+    {
+      auto &nets = contested_nets[i];
+      for (int n : net_route.node_nets(i))
+        nets.insert(net_net[n]);
+    }
+  
+  *logs << "most contested routing resources:\n";
+  for (int i : nodes)
+    {
+      int t = graph.net_tile[i];
+      *logs << "  " << chipdb->tile_x(t) << " " << chipdb->tile_y(t);
+      for (const auto &p : chipdb->tile_nets()[t])
+        {
+          if (p.second == i)
+            {
+              *logs << " " << chipdb->net_names().name(p.first);
+              break;
+            }
+        }
+      *logs << " (" << span_type_name(graph.net_span_type[i])
+            << "): overused in " << contested_passes[i]
+            << " passes, demand " << demand[i] << ", nets";
+      for (Net *n : contested_nets.at(i))
+        *logs << " " << n->name();
+      *logs << "\n";
+    }
+}
+
+bool
+Router::net_congested(int net) const
+{
+  return net_n_overused[net] > 0;
+}
+
+// unrouted, or routed through an overused node
+bool
+Router::reroute_due(int net) const
+{
+  return net_route[net].empty() || net_congested(net);
+}
+
+void
+Router::route_net(int n)
+{
+  current_net = n;
+  ++stats_rerouted;
+  
+  const auto &targets = net_targets[n];
+  
+  unrouted.clear();
+  for (int i : targets)
+    // not extend, e.g., lutff_global/clk
+    unrouted.insert(i);
+  
+  ripup(n);
+  set_window(n);
+  route_delay[net_source[n]] = 0;
+  
+  if (chipdb->net_global()[net_source[n]] >= 0
+      && route_global_net(n))
+    {
+      unrouted.clear();
+      goto D;
+    }
+  
+  if (use_bidir
+      && targets.size() == 1
+      && chipdb->net_global()[net_source[n]] < 0)
+    {
+    M:
+      if (route_two_pin(n))
+        {
+          unrouted.clear();
+          goto D;
+        }
+      if (widen_window(n))
+        goto M;
+    }
+  
+ L:
+  // *logs << "start:";
+  
+  if (timing_driven)
+    select_target(n);
+  
+  if (use_astar)
+    {
+      set_astar_targets();
+      astar = true;
+    }
+  start(n);
+  while (!frontier.empty())
+    {
+      int cn = pop();
+      
+      if (timing_driven
+          ? cn == current_target
+          : unrouted.contains(cn))
+        {
+          unrouted.erase(cn);
+          traceback(n, cn);
+          
+          if (unrouted.empty())
+            break;
+          else
+            goto L;
+        }
+      else
+        visit(cn);
+    }
+  astar = false;
+  
+  if (!unrouted.empty()
+      && widen_window(n))
+    goto L;
+  
+  if (!unrouted.empty())
+    {
+      *logs << net_source[n] << " ->";
+      for (int t : targets)
+        *logs << " " << t;
+      *logs << "\n";
+    }
+  
+  assert(unrouted.empty());
+  
+ D:
+  if (timing_driven)
+    {
+      for (int i = 0; i < (int)targets.size(); ++i)
+        net_target_delay[n][i] = route_delay[targets[i]];
+    }
+  
+  // couldn't find an uncongested route inside the window
+  if (passes > 1
+      && net_congested(n))
+    widen_window(n);
+}
+
+// Make the route of net, and what routing it leaves behind, the same
+// as in from.
+void
+Router::copy_route(const Router &from, int net)
+{
+  ripup(net);
+  route_delay[net_source[net]] = 0;
+  for (const auto &p : from.net_route[net])
+    {
+      add_route_node(net, p.first, p.second);
+      route_delay[p.second] = from.route_delay[p.second];
+    }
+  net_bb_margin[net] = from.net_bb_margin[net];
+  if (timing_driven)
+    net_target_delay[net] = from.net_target_delay[net];
+}
+
+// In a worker: catch up with master, then route net, if not -1, as
+// master would if it were next, noting the nodes whose demand that
+// depends on.
+void
+Router::speculate(const Router &master, int net)
+{
+  if (passes != master.passes)
+    {
+      passes = master.passes;
+      historical_demand = master.historical_demand;
+      if (timing_driven)
+        net_target_crit = master.net_target_crit;
+    }
+  for (int n : master.batch_rerouted)
+    copy_route(master, n);
+  if (spec_net >= 0)
+    copy_route(master, spec_net);
+  
+  spec_net = net;
+  if (net < 0)
+    return;
+  
+  reads.clear();
+  record_reads = true;
+  route_net(net);
+  record_reads = false;
+}
+
+// In a worker: whether its speculative route read a node in changed.
+bool
+Router::reads_dirty(const UllmanSet &changed) const
+{
+  if (reads.size() <= changed.size())
+    {
+      for (int k = 0; k < (int)reads.size(); ++k)
+        {
+          if (changed.contains(reads.ith(k)))
+            return true;
+        }
+    }
+  else
+    {
+      for (int k = 0; k < (int)changed.size(); ++k)
+        {
+          if (reads.contains(changed.ith(k)))
+            return true;
+        }
+    }
+  return false;
+}
+
+// The serial loop in route(), n_threads nets at a time.  Each batch
+// takes the next nets due, one per worker, and the workers route them
+// in parallel from the current state, each as if its net were next.
+// Then, in net order, each net still due keeps its speculative route
+// if none of the nodes whose demand the search read has changed in
+// the batch, and is rerouted here otherwise.  Either way it ends up
+// with the route the serial loop would give it, so the result doesn't
+// depend on n_threads.
+void
+Router::reroute_parallel()
+{
+  int n_order = net_order.size();
+  std::vector<int> batch;
+  for (int pos = 0; pos < n_order; )
+    {
+      batch.clear();
+      for (int i = pos;
+           i < n_order && (int)batch.size() < n_threads;
+           ++i)
+        {
+          if (reroute_due(net_order[i]))
+            batch.push_back(i);
+        }
+      if (batch.empty())
+        break;
+      
+      // workers without a net still catch up
+      std::vector<std::thread> threads;
+      for (int w = 1; w < n_threads; ++w)
+        threads.push_back(std::thread(&Router::speculate, workers[w],
+                                      std::cref(*this),
+                                      (w < (int)batch.size()
+                                       ? net_order[batch[w]]
+                                       : -1)));
+      workers[0]->speculate(*this, net_order[batch[0]]);
+      for (std::thread &t : threads)
+        t.join();
+      
+      batch_rerouted.clear();
+      dirty.clear();
+      int b = 0;
+      for (int i = pos; i <= batch.back(); ++i)
+        {
+          int n = net_order[i];
+          Router *w = nullptr;
+          if (b < (int)batch.size()
+              && batch[b] == i)
+            w = workers[b++];
+          if (!reroute_due(n))
+            continue;
+          
+          bool keep = w && !w->reads_dirty(dirty);
+          for (const auto &p : net_route[n])
+            dirty.insert(p.second);
+          if (keep)
+            {
+              ++stats_rerouted;
+              ++stats_spec_kept;
+              copy_route(*w, n);
+            }
+          else
+            route_net(n);
+          for (const auto &p : net_route[n])
+            dirty.insert(p.second);
+          batch_rerouted.push_back(n);
+        }
+      
+      for (int w = 0; w < (int)batch.size(); ++w)
+        {
+          Router *wr = workers[w];
+          ++stats_spec;
+          stats_pushes += wr->stats_pushes;
+          stats_pops += wr->stats_pops;
+          stats_expanded += wr->stats_expanded;
+          stats_max_frontier = std::max(stats_max_frontier,
+                                        wr->stats_max_frontier);
+          wr->stats_pushes = 0;
+          wr->stats_pops = 0;
+          wr->stats_expanded = 0;
+          wr->stats_max_frontier = 0;
+        }
+      
+      pos = batch.back() + 1;
+    }
+}
+
+void
+Router::order_nets()
+{
+  switch(net_order_kind)
+    {
+    case RouteNetOrder::INDEX:
+      break;
+    case RouteNetOrder::FANOUT:
+      std::stable_sort(net_order.begin(), net_order.end(),
+                       [this](int a, int b) {
+                         return net_targets[a].size() > net_targets[b].size();
+                       });
+      break;
+    case RouteNetOrder::BBOX:
+      std::stable_sort(net_order.begin(), net_order.end(),
+                       [this](int a, int b) {
+                         return ((net_xmax[a] - net_xmin[a]) + (net_ymax[a] - net_ymin[a])
+                                 > (net_xmax[b] - net_xmin[b]) + (net_ymax[b] - net_ymin[b]));
+                       });
+      break;
+    case RouteNetOrder::CRITICALITY:
+      {
+        std::vector<float> net_crit(n_nets, 0);
+        for (int n = 0; n < n_nets; ++n)
+          for (float crit : net_target_crit[n])
+            net_crit[n] = std::max(net_crit[n], crit);
+        std::sort(net_order.begin(), net_order.end());
+        std::stable_sort(net_order.begin(), net_order.end(),
+                         [&net_crit](int a, int b) {
+                           return net_crit[a] > net_crit[b];
+                         });
+      }
+      break;
+    case RouteNetOrder::RANDOM:
+      for (int i = n_nets - 1; i > 0; --i)
+        std::swap(net_order[i], net_order[random_int(0, i, rg)]);
+      break;
+    }
+}
+
+void
+Router::warm_start(const Configuration &prev_conf)
+{
+  // nets driving each routing node through a switch that is on in
+  // prev_conf.  Bidirectional switches show up in both directions.
+  std::vector<std::vector<int>> active_in(chipdb->n_nets);
+  for (int t = 0; t < chipdb->n_tiles; ++t)
+    {
+      const std::vector<int> &nets = chipdb->tile_switch_nets()[t];
+      for (const SwitchPattern &sp : chipdb->tile_switches(t))
+        {
+          unsigned v = 0;
+          for (unsigned i = 0; i < sp.cbits.size(); ++i)
+            if (prev_conf.get_cbit(CBit(t,
+                                        sp.cbits[i].first,
+                                        sp.cbits[i].second)))
+              v |= (1 << i);
+          if (!v)
+            continue;
+          
+          for (const auto &p : sp.in_val)
+            if (p.second == v)
+              active_in[nets[sp.out]].push_back(nets[p.first]);
+        }
+    }
+  
+  int n_kept = 0;
+  UllmanSet tree(chipdb->n_nets);
+  std::vector<int> queue;
+  for (int n = 0; n < n_nets; ++n)
+    {
+      int source = net_source[n];
+      const auto &targets = net_targets[n];
+      
+      tree.clear();
+      tree.insert(source);
+      route_delay[source] = 0;
+      
+      // search backwards from each target along active switches to
+      // the source or the part of the tree found so far
+      bool ok = true;
+      for (int target : targets)
+        {
+          if (tree.contains(target))
+            continue;
+          
+          visited.clear();
+          visited.insert(target);
+          queue.clear();
+          queue.push_back(target);
+          int root = -1,
+            root_prev = -1;
+          for (int qi = 0; qi < (int)queue.size() && root < 0; ++qi)
+            {
+              int cn = queue[qi];
+              for (int prev : active_in[cn])
+                {
+                  if (tree.contains(prev))
+                    {
+                      root = cn;
+                      root_prev = prev;
+                      break;
+                    }
+                  if (visited.contains(prev))
+                    continue;
+                  visited.insert(prev);
+                  // backptr points towards the target while searching
+                  backptr[prev] = cn;
+                  queue.push_back(prev);
+                }
+            }
+          if (root < 0)
+            {
+              ok = false;
+              break;
+            }
+          
+          // walk root -> target
+          int prev = root_prev;
+          int cn = root;
+          for (;;)
+            {
+              int next = (cn == target) ? -1 : backptr[cn];
+              add_route_node(n, prev, cn);
+              tree.insert(cn);
+              route_delay[cn] = route_delay[prev] + graph.net_delay[cn];
+              if (next < 0)
+                break;
+              prev = cn;
+              cn = next;
+            }
+        }
+      
+      if (!ok)
+        {
+          ripup(n);
+          continue;
+        }
+      
+      ++n_kept;
+      if (!net_target_delay.empty())
+        {
+          for (int i = 0; i < (int)targets.size(); ++i)
+            net_target_delay[n][i] = route_delay[targets[i]];
+        }
+    }
+  
+  *logs << "  warm start: kept routes of " << n_kept << " / " << n_nets << " nets\n";
+}
+
+void
+Router::pre_route_high_fanout()
+{
+  std::vector<int> hf_nets;
+  for (int n = 0; n < n_nets; ++n)
+    {
+      if ((int)net_targets[n].size() >= high_fanout
+          && chipdb->net_global()[net_source[n]] < 0)
+        hf_nets.push_back(n);
+    }
+  if (hf_nets.empty())
+    return;
+  
+  std::stable_sort(hf_nets.begin(), hf_nets.end(),
+                   [this](int a, int b) {
+                     return net_targets[a].size() > net_targets[b].size();
+                   });
+  
+  // negotiate among the high-fanout nets alone; the main passes
+  // route everything else around them
+  int max_pre_route_passes = std::min(max_passes - 1, 10);
+  for (passes = 1; passes <= max_pre_route_passes; ++passes)
+    {
+      for (int n : hf_nets)
+        {
+          if (!net_route[n].empty()
+              && !net_congested(n))
+            continue;
+          route_net(n);
+        }
+      
+      *logs << "  pre-route pass " << passes << ", "
+            << hf_nets.size() << " high-fanout nets, "
+            << n_shared << " shared.\n";
+      if (!n_shared)
+        break;
+      
+      if (passes > 1)
+        {
+          for (int k = 0; k < (int)overused.size(); ++k)
+            {
+              int i = overused.ith(k);
+              historical_demand[i] += demand[i];
+            }
+        }
+    }
+}
+
+void
+Router::route()
+{
+  // d->dump();
+  
+  Model *top = d->top();
+  
+  std::set<Net *, IdLess> boundary_nets = top->boundary_nets(d);
+  for (const auto &p : top->nets())
+    {
+      Net *n = p.second;
+      if (contains(boundary_nets, n))
+        continue;
+      
+#ifndef NDEBUG
+      if (n->is_constant())
+        {
+          Value v = n->constant();
+          assert(v == Value::ZERO || v == Value::ONE);
+          
+          for (auto p2 : n->connections())
+            {
+              Instance *inst = cast<Instance>(p2->node());
+              
+              if (models.is_lc(inst)
+                  && p2->name() == "CIN")
+                {
+                  int cell = placement.at(inst);
+                  const Location &loc = chipdb->cell_location[cell];
+                  if (loc.pos() == 0)
+                    continue;
+                }
+              
+              assert(p2->is_input()
+                     && !p2->is_bidir()
+                     && p2->undriven() == v);
+            }
+        }
+#endif
+      
+      int source = -1;
+      std::vector<int> targets;
+      std::vector<Port *> target_ports;
+      
+      // *logs << n->name() << "\n";
+      
+      for (auto p2 : n->connections())
+        {
+          assert(p2->connection() == n);
+          assert(isa<Instance>(p2->node()));
+          
+          Instance *inst = cast<Instance>(p2->node());
+          int cn = port_cnet(inst, p2);
+          
+          // like lutff_i/cin
+          if (cn < 0)
+            continue;
           
 #if 1
           if (cnet_net[cn]
@@ -735,6 +2275,7 @@ Router::route()
             {
               assert(p2->is_input());
               targets.push_back(cn);
+              target_ports.push_back(p2);
             }
         }
       
@@ -754,111 +2295,166 @@ Router::route()
           
           net_source.push_back(source);
           net_targets.push_back(std::move(targets));
+          net_target_ports.push_back(std::move(target_ports));
           net_net.push_back(n);
         }
     }
   
   net_route.resize(n_nets);
+  net_n_overused.resize(n_nets, 0);
   
-  for (passes = 1; passes <= max_passes; ++passes)
+  net_xmin.resize(n_nets);
+  net_xmax.resize(n_nets);
+  net_ymin.resize(n_nets);
+  net_ymax.resize(n_nets);
+  net_bb_margin.resize(n_nets, bb_margin);
+  for (int n = 0; n < n_nets; ++n)
+    {
+      int source = net_source[n];
+      int xmin = cnet_xmin[source],
+        xmax = cnet_xmax[source],
+        ymin = cnet_ymin[source],
+        ymax = cnet_ymax[source];
+      for (int cn : net_targets[n])
+        {
+          xmin = std::min(xmin, cnet_xmin[cn]);
+          xmax = std::max(xmax, cnet_xmax[cn]);
+          ymin = std::min(ymin, cnet_ymin[cn]);
+          ymax = std::max(ymax, cnet_ymax[cn]);
+        }
+      net_xmin[n] = xmin;
+      net_xmax[n] = xmax;
+      net_ymin[n] = ymin;
+      net_ymax[n] = ymax;
+    }
+  
+  if (timing_driven
+      || net_order_kind == RouteNetOrder::CRITICALITY)
     {
+      net_target_delay.resize(n_nets);
+      net_target_crit.resize(n_nets);
       for (int n = 0; n < n_nets; ++n)
         {
-          current_net = n;
-          
-          const auto &targets = net_targets[n];
-          
-          if (passes > 1)
-            {
-              assert(net_route[n].size() > 0);
-              for (const auto &p : net_route[n])
-                {
-                  if (demand[p.second] > 1)
-                    goto M;
-                }
-              continue;
-            }
-          
-        M:
-          unrouted.clear();
-          for (int i : targets)
-            // not extend, e.g., lutff_global/clk
-            unrouted.insert(i);
-          
-          ripup(n);
-          
-        L:
-          // *logs << "start:";
-          
-          start(n);
-          while (!frontier.empty())
-            {
-              int cn = pop();
-              
-              if (unrouted.contains(cn))
-                {
-                  unrouted.erase(cn);
-                  traceback(n, cn);
-                  
-                  if (unrouted.empty())
-                    break;
-                  else
-                    goto L;
-                }
-              else
-                visit(cn);
-            }
-          
-          if (!unrouted.empty())
+          net_target_delay[n].resize(net_targets[n].size(), 0);
+          net_target_crit[n].resize(net_targets[n].size(), 0);
+        }
+      
+      build_timing_graph();
+      estimate_delays();
+      analyze_timing();
+      *logs << "  estimated critical path " << critical_path_delay << "ps\n";
+    }
+  
+  net_order.resize(n_nets);
+  for (int n = 0; n < n_nets; ++n)
+    net_order[n] = n;
+  
+  if (warm_start_conf)
+    {
+      warm_start(*warm_start_conf);
+      if (timing_driven)
+        analyze_timing();
+    }
+  
+  if (high_fanout > 0)
+    pre_route_high_fanout();
+  
+  if (n_threads > 1)
+    {
+      for (int w = 0; w < n_threads; ++w)
+        {
+          Router *wr = new Router(*this);
+          wr->passes = 0;
+          wr->reads.resize(chipdb->n_nets);
+          workers.push_back(wr);
+        }
+      dirty.resize(chipdb->n_nets);
+    }
+  
+  int best_shared = -1,
+    best_pass = 0;
+  for (passes = 1; passes <= max_passes; ++passes)
+    {
+      auto pass_start = std::chrono::steady_clock::now();
+      stats_rerouted = 0;
+      stats_pushes = 0;
+      stats_pops = 0;
+      stats_expanded = 0;
+      stats_max_frontier = 0;
+      stats_spec = 0;
+      stats_spec_kept = 0;
+      
+      order_nets();
+      if (n_threads > 1)
+        reroute_parallel();
+      else
+        {
+          for (int n : net_order)
             {
-              *logs << net_source[n] << " ->";
-              for (int t : targets)
-                *logs << " " << t;
-              *logs << "\n";
+              if (reroute_due(n))
+                route_net(n);
             }
-          
-          assert(unrouted.empty());
-          
-          // *logs << "\n";
-          
-          // check();
         }
       
-      *logs << "  pass " << passes << ", " << n_shared << " shared.\n";
+      *logs << "  pass " << passes << ", " << n_shared << " shared";
+      if (timing_driven)
+        {
+          analyze_timing();
+          *logs << ", critical path " << critical_path_delay << "ps";
+        }
+      *logs << ".\n";
+      
+      if (stats)
+        {
+          std::chrono::duration<double> pass_time
+            = std::chrono::steady_clock::now() - pass_start;
+          write_pass_stats(pass_time.count());
+        }
+      
       if (!n_shared)
         break;
       
+      for (int k = 0; k < (int)overused.size(); ++k)
+        ++contested_passes[overused.ith(k)];
+      
+      if (best_shared < 0
+          || n_shared < best_shared)
+        {
+          best_shared = n_shared;
+          best_pass = passes;
+        }
+      else if (stall_passes > 0
+               && passes - best_pass >= stall_passes)
+        {
+          report_contested();
+          fatal(fmt("failed to route: no progress since pass " << best_pass
+                    << " (" << best_shared << " shared)"));
+        }
+      
       if (passes > 1)
         {
-          for (int i = 0; i < chipdb->n_nets; ++i)
+          for (int k = 0; k < (int)overused.size(); ++k)
             {
-              if (demand[i] > 1)
-                historical_demand[i] += demand[i];
+              int i = overused.ith(k);
+              historical_demand[i] += demand[i];
             }
         }
 
 #if 0
       if (n_shared < 5)
         {
-          std::map<int, std::set<int>> net_route_reverse;
-
-          for (int i = 0; i < n_nets; ++i)
-              for (const auto &p : net_route[i])
-                  if (demand[p.second] > 1)
-                    net_route_reverse[p.second].insert(i);
-
           for (int i = 0; i < chipdb->n_nets; ++i)
             if (demand[i] > 1)
               {
-                if (chipdb->net_tile_name.empty())
+                if (chipdb->net_tile_name().empty())
                   *logs << "    shared net #" << i << " (demand = " << demand[i] << ").\n";
                 else
                   {
-                    auto &net_tile_name = chipdb->net_tile_name.at(i);
+                    auto &net_tile_name = chipdb->net_tile_name().at(i);
                     int tile_x = chipdb->tile_x(net_tile_name.first), tile_y = chipdb->tile_y(net_tile_name.first);
                     *logs << "    shared net #" << i << " (demand = " << demand[i] << ") in tile " << tile_x << "," << tile_y << ": " << net_tile_name.second << "\n";
                   }
-                for (auto j : net_route_reverse.at(i))
+                for (int j : net_route.node_nets(i))
                   *logs << "      used by wire " << net_net[j]->name() << "\n";
               }
         }
@@ -891,57 +2487,53 @@ Router::route()
 #endif
     }
   
+  for (Router *w : workers)
+    delete w;
+  workers.clear();
+  
   if (n_shared)
-    fatal("failed to route");
+    {
+      report_contested();
+      fatal("failed to route");
+    }
   
   int n_span4 = 0,
     n_span12 = 0;
-  BitVector is_span4(chipdb->n_nets),
-    is_span12(chipdb->n_nets);
-  for (int i = 0; i < chipdb->n_tiles; ++i)
+  for (int i = 0; i < chipdb->n_nets; ++i)
     {
-      for (const auto &p : chipdb->tile_nets[i])
-        {
-          const std::string &name = p.first;
-          int cn = p.second;
-          
-          if (is_span4[cn] || is_span12[cn])
-            continue;
-          
-          if (is_prefix("span4_", name)
-              || is_prefix("sp4_", name))      
-            {
-              is_span4[cn] = true;
-              ++n_span4;
-            }
-          else if (is_prefix("span12_", name)
-                   || is_prefix("sp12_", name))
-            {
-              is_span12[cn] = true;
-              ++n_span12;
-            }
-        }
+      if (graph.net_span_type[i] == SpanType::SPAN4)
+        ++n_span4;
+      else if (graph.net_span_type[i] == SpanType::SPAN12)
+        ++n_span12;
     }
   
+  std::vector<int> colbuf_func(chipdb->n_global_nets);
+  for (int g = 0; g < chipdb->n_global_nets; ++g)
+    colbuf_func[g] = chipdb->func_id(fmt("ColBufCtrl.glb_netwk_" << g));
+  
   int n_span4_used = 0,
     n_span12_used = 0;
-  for (const auto &v : net_route)
-    for (const auto &p : v)
+  for (int i = 0; i < n_nets; ++i)
+    for (const auto &p : net_route[i])
       {
-        if (is_span4[p.second])
+        SpanType st = graph.net_span_type[p.second];
+        if (st == SpanType::SPAN4)
           ++n_span4_used;
-        else if (is_span12[p.second])
+        else if (st == SpanType::SPAN12)
           ++n_span12_used;
         
-        int s = chipdb->find_switch(p.first, p.second);
-        const Switch &sw = chipdb->switches[s];
+        int e = graph.in_edge(p.first, p.second);
+        SwitchSetting ss = chipdb->switch_setting(graph.in_switch[e],
+                                                  p.first);
+        assert(ss.value == graph.in_switch_val[e]);
         
-        assert(!contains(chipdb->net_global, p.second));
-        if (contains(chipdb->net_global, p.first) && (chipdb->device != "384"))
+        assert(chipdb->net_global()[p.second] < 0);
+        if (chipdb->net_global()[p.first] >= 0 && (chipdb->device != "384"))
           {
-            int g = chipdb->net_global.at(p.first);
+            int g = chipdb->net_global()[p.first];
             
-            int cb_t = chipdb->tile_colbuf_tile.at(sw.tile);
+            int cb_t = chipdb->tile_colbuf_tile[ss.tile];
+            assert(cb_t >= 0);
             
             if (chipdb->device == "1k"
                 && chipdb->tile_type[cb_t] == TileType::RAMT)
@@ -951,9 +2543,8 @@ Router::route()
                 assert(chipdb->tile_type[cb_t] == TileType::RAMB);
               }
             
-            const CBit &colbuf_cbit = (chipdb->tile_nonrouting_cbits
-                                       .at(chipdb->tile_type[cb_t])
-                                       .at(fmt("ColBufCtrl.glb_netwk_" << g))
+            const CBit &colbuf_cbit = (chipdb->func_cbits(chipdb->tile_type[cb_t])
+                                       .at(colbuf_func[g])
                                        [0]);
             conf.set_cbit(CBit(cb_t,
                                colbuf_cbit.row,
@@ -961,20 +2552,22 @@ Router::route()
                           1);
           }
         
-        conf.set_cbits(sw.cbits,
-                       sw.in_val.at(p.first));
+        conf.set_cbits(ss.tile, *ss.cbits, ss.value);
       }
   
   *logs << "\n"
         << "After routing:\n"
         << "span_4     " << n_span4_used << " / " << n_span4 << "\n"
         << "span_12    " << n_span12_used << " / " << n_span12 << "\n\n";
+  
+  if (utilization || heatmap)
+    report_utilization();
 }
 
 void
-route(DesignState &ds, int max_passes)
+route(random_generator &rg, DesignState &ds, const RouteOptions &opts)
 {
-  Router router(ds, max_passes);
+  Router router(rg, ds, opts);
   
   clock_t start = clock();
   router.route();
@@ -16,8 +16,84 @@
 #ifndef PNR_ROUTE_HH
 #define PNR_ROUTE_HH
 
+#include <ostream>
+
+class random_generator;
 class DesignState;
+class Configuration;
+
+// order in which nets are (re)routed within a pass
+enum class RouteNetOrder {
+  INDEX, FANOUT, BBOX, CRITICALITY, RANDOM
+};
+
+class RouteOptions
+{
+public:
+  int max_passes;
+  
+  // give up if the number of overused nodes hasn't reached a new
+  // minimum in this many passes.  0 disables.
+  int stall_passes;
+  
+  // search window: net pin bounding box expanded by bb_margin tiles.
+  // 0 disables (the whole chip).
+  int bb_margin;
+  
+  // guide searches toward their sinks with the chipdb lookahead
+  bool astar;
+  
+  // route two-pin nets by searching from both ends at once
+  bool bidir;
+  
+  // reroute up to this many nets at a time in parallel; 0 or 1
+  // reroutes one at a time.  The routes found are the same for any
+  // value.
+  int threads;
+  
+  // blend sink criticality-weighted delay into the routing cost
+  bool timing_driven;
+  
+  RouteNetOrder net_order;
+  
+  // non-global nets with at least this many sinks are routed, and
+  // made congestion-free among themselves, before the main passes.
+  // 0 disables.
+  int high_fanout;
+  
+  // if non-null, routes found in this configuration (read from a
+  // previous .asc) are kept for nets they still connect
+  const Configuration *warm_start;
+  
+  // if non-null, per-pass search and congestion statistics are
+  // written here
+  std::ostream *stats;
+  
+  // if non-null, per-tile routing utilization and placer demand are
+  // written here as CSV
+  std::ostream *utilization;
+  
+  // log an ASCII map of routing utilization after routing
+  bool heatmap;
+  
+public:
+  RouteOptions()
+    : max_passes(200),
+      stall_passes(0),
+      bb_margin(0),
+      astar(false),
+      bidir(false),
+      threads(1),
+      timing_driven(false),
+      net_order(RouteNetOrder::INDEX),
+      high_fanout(0),
+      warm_start(nullptr),
+      stats(nullptr),
+      utilization(nullptr),
+      heatmap(false)
+  {}
+};
 
-void route(DesignState &ds, int max_passes);
+void route(random_generator &rg, DesignState &ds, const RouteOptions &opts);
 
 #endif
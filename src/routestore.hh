@@ -0,0 +1,261 @@
+/* Copyright (C) 2015 Cotton Seed
+   
+   This file is part of arachne-pnr.  Arachne-pnr is free software;
+   you can redistribute it and/or modify it under the terms of the GNU
+   General Public License version 2 as published by the Free Software
+   Foundation.
+   
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program. If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef PNR_ROUTESTORE_HH
+#define PNR_ROUTESTORE_HH
+
+#include <vector>
+#include <utility>
+#include <cassert>
+
+// The routes of a set of nets, each a list of edges (prev, node) in
+// the order added, and for each node the nets whose routes use it.
+//
+// Edges are kept in fixed-size segments chained per net, and node
+// occupancy in cells chained per node.  Both come from arenas shared
+// by all nets, and clearing a route puts its segments and cells on
+// free lists, so ripping up and rerouting nets doesn't allocate once
+// the arenas have grown to the peak total route size.
+class RouteStore
+{
+  static const int segment_edges = 15;
+  
+  class Segment
+  {
+  public:
+    int next;  // -1 if last
+    int n_edges;
+    std::pair<int, int> edges[segment_edges];
+  };
+  
+  // a net's route is segments[net_first[net]] onwards, ending with
+  // net_last[net], or empty if -1
+  std::vector<int> net_first;
+  std::vector<int> net_last;
+  std::vector<int> net_size;
+  std::vector<Segment> segments;
+  int free_segment;
+  
+  // the nets using node i are cell_net[c] for c = node_first[i],
+  // cell_next[c], ... until -1, most recently added first
+  std::vector<int> node_first;
+  std::vector<int> cell_net;
+  std::vector<int> cell_next;
+  int free_cell;
+  
+  int new_segment()
+  {
+    int s = free_segment;
+    if (s >= 0)
+      free_segment = segments[s].next;
+    else
+      {
+        s = segments.size();
+        segments.push_back(Segment());
+      }
+    segments[s].next = -1;
+    segments[s].n_edges = 0;
+    return s;
+  }
+  
+  int new_cell()
+  {
+    int c = free_cell;
+    if (c >= 0)
+      free_cell = cell_next[c];
+    else
+      {
+        c = cell_net.size();
+        cell_net.push_back(-1);
+        cell_next.push_back(-1);
+      }
+    return c;
+  }
+  
+  void unlink(int node, int net)
+  {
+    int *p = &node_first[node];
+    while (cell_net[*p] != net)
+      {
+        p = &cell_next[*p];
+        assert(*p >= 0);
+      }
+    int c = *p;
+    *p = cell_next[c];
+    cell_next[c] = free_cell;
+    free_cell = c;
+  }
+  
+public:
+  class const_iterator
+  {
+    const RouteStore *store;
+    int s, i;
+    
+  public:
+    const_iterator(const RouteStore *store_, int s_)
+      : store(store_), s(s_), i(0)
+    {}
+    
+    const std::pair<int, int> &operator*() const
+    {
+      return store->segments[s].edges[i];
+    }
+    const std::pair<int, int> *operator->() const { return &operator*(); }
+    
+    const_iterator &operator++()
+    {
+      if (++i == store->segments[s].n_edges)
+        {
+          s = store->segments[s].next;
+          i = 0;
+        }
+      return *this;
+    }
+    
+    bool operator==(const const_iterator &rhs) const
+    {
+      return s == rhs.s && i == rhs.i;
+    }
+    bool operator!=(const const_iterator &rhs) const { return !operator==(rhs); }
+  };
+  
+  // the route of a net, as a range of edges
+  class Route
+  {
+    const RouteStore *store;
+    int net;
+    
+  public:
+    Route(const RouteStore *store_, int net_)
+      : store(store_), net(net_)
+    {}
+    
+    const_iterator begin() const
+    {
+      return const_iterator(store, store->net_first[net]);
+    }
+    const_iterator end() const { return const_iterator(store, -1); }
+    int size() const { return store->net_size[net]; }
+    bool empty() const { return store->net_first[net] < 0; }
+  };
+  
+  class node_net_iterator
+  {
+    const RouteStore *store;
+    int c;
+    
+  public:
+    node_net_iterator(const RouteStore *store_, int c_)
+      : store(store_), c(c_)
+    {}
+    
+    int operator*() const { return store->cell_net[c]; }
+    node_net_iterator &operator++()
+    {
+      c = store->cell_next[c];
+      return *this;
+    }
+    
+    bool operator==(const node_net_iterator &rhs) const { return c == rhs.c; }
+    bool operator!=(const node_net_iterator &rhs) const { return c != rhs.c; }
+  };
+  
+  // the nets using a node
+  class NodeNets
+  {
+    const RouteStore *store;
+    int node;
+    
+  public:
+    NodeNets(const RouteStore *store_, int node_)
+      : store(store_), node(node_)
+    {}
+    
+    node_net_iterator begin() const
+    {
+      return node_net_iterator(store, store->node_first[node]);
+    }
+    node_net_iterator end() const { return node_net_iterator(store, -1); }
+    bool empty() const { return store->node_first[node] < 0; }
+  };
+  
+public:
+  RouteStore()
+    : free_segment(-1), free_cell(-1)
+  {}
+  RouteStore(int n_nodes)
+    : free_segment(-1), node_first(n_nodes, -1), free_cell(-1)
+  {}
+  
+  int n_nets() const { return net_first.size(); }
+  int n_nodes() const { return node_first.size(); }
+  
+  // grows to n nets; new nets have empty routes
+  void resize(int n)
+  {
+    assert(n >= n_nets());
+    net_first.resize(n, -1);
+    net_last.resize(n, -1);
+    net_size.resize(n, 0);
+  }
+  
+  Route operator[](int net) const { return Route(this, net); }
+  NodeNets node_nets(int node) const { return NodeNets(this, node); }
+  
+  // append edge (prev, node) to the route of net
+  void add(int net, int prev, int node)
+  {
+    int s = net_last[net];
+    if (s < 0 || segments[s].n_edges == segment_edges)
+      {
+        int s2 = new_segment();
+        if (s < 0)
+          net_first[net] = s2;
+        else
+          segments[s].next = s2;
+        net_last[net] = s2;
+        s = s2;
+      }
+    Segment &seg = segments[s];
+    seg.edges[seg.n_edges++] = std::make_pair(prev, node);
+    ++net_size[net];
+    
+    int c = new_cell();
+    cell_net[c] = net;
+    cell_next[c] = node_first[node];
+    node_first[node] = c;
+  }
+  
+  // empty the route of net
+  void clear(int net)
+  {
+    int s = net_first[net];
+    if (s < 0)
+      return;
+    
+    for (int t = s; t >= 0; t = segments[t].next)
+      for (int i = 0; i < segments[t].n_edges; ++i)
+        unlink(segments[t].edges[i].second, net);
+    
+    segments[net_last[net]].next = free_segment;
+    free_segment = s;
+    net_first[net] = -1;
+    net_last[net] = -1;
+    net_size[net] = 0;
+  }
+};
+
+#endif
@@ -94,7 +94,7 @@ public:
       }
   }
   
-  int ith(int i)
+  int ith(int i) const
   {
     assert(i >= 0 && i < (int)n);
     return key[i];
@@ -19,6 +19,8 @@
 #include "bstream.hh"
 
 #include <vector>
+#include <cstdint>
+#include <cstring>
 
 template<typename T,
          typename std::vector<T>::size_type B>
@@ -112,6 +114,123 @@ ibstream &operator>>(ibstream &ibs, BasedVector<T, B> &bv)
   return ibs >> bv.underlying();
 }
 
+// Read-only array of 4-byte values that either owns its elements or
+// refers to memory owned elsewhere, typically a mapped binary chipdb.
+// Serialized as a fixed-width little-endian block so it can be used in
+// place.
+template<typename T>
+class FlatVector
+{
+  static_assert(sizeof(T) == 4, "FlatVector elements must be 4 bytes");
+  
+  std::vector<T> v;
+  const T *p;
+  size_t n;
+  
+public:
+  FlatVector() : p(nullptr), n(0) {}
+  FlatVector(std::vector<T> &&v_) : v(std::move(v_)), p(v.data()), n(v.size()) {}
+  FlatVector(const T *p_, size_t n_) : p(p_), n(n_) {}
+  FlatVector(const FlatVector &other) { *this = other; }
+  FlatVector(FlatVector &&other)
+    : v(std::move(other.v)), p(other.p), n(other.n)
+  {}
+  
+  FlatVector &operator=(const FlatVector &other)
+  {
+    v = other.v;
+    p = v.empty() ? other.p : v.data();
+    n = other.n;
+    return *this;
+  }
+  FlatVector &operator=(FlatVector &&other)
+  {
+    v = std::move(other.v);
+    p = other.p;
+    n = other.n;
+    return *this;
+  }
+  FlatVector &operator=(std::vector<T> &&v_)
+  {
+    v = std::move(v_);
+    p = v.data();
+    n = v.size();
+    return *this;
+  }
+  
+  bool empty() const { return n == 0; }
+  size_t size() const { return n; }
+  bool owned() const { return p == v.data(); }
+  
+  const T *data() const { return p; }
+  const T *begin() const { return p; }
+  const T *end() const { return p + n; }
+  
+  const T &operator[](size_t i) const
+  {
+    assert(i < n);
+    return p[i];
+  }
+};
+
+inline bool
+host_is_little_endian()
+{
+  const uint32_t x = 1;
+  return *reinterpret_cast<const unsigned char *>(&x) == 1;
+}
+
+template<typename T>
+obstream &operator<<(obstream &obs, const FlatVector<T> &fv)
+{
+  obs << fv.size();
+  obs.align(4);
+  if (host_is_little_endian())
+    obs.write(reinterpret_cast<const char *>(fv.data()), fv.size() * 4);
+  else
+    for (const T &x : fv)
+      {
+        uint32_t u;
+        memcpy(&u, &x, 4);
+        char b[4] = {(char)u, (char)(u >> 8), (char)(u >> 16), (char)(u >> 24)};
+        obs.write(b, 4);
+      }
+  return obs;
+}
+
+template<typename T>
+ibstream &operator>>(ibstream &ibs, FlatVector<T> &fv)
+{
+  size_t n;
+  ibs >> n;
+  ibs.align(4);
+  const char *p = ibs.in_place(n * 4);
+  if (p
+      && host_is_little_endian()
+      && reinterpret_cast<uintptr_t>(p) % alignof(T) == 0)
+    {
+      fv = FlatVector<T>(reinterpret_cast<const T *>(p), n);
+      return ibs;
+    }
+  
+  std::vector<T> v(n);
+  for (size_t i = 0; i < n; ++i)
+    {
+      unsigned char b[4];
+      if (p)
+        memcpy(b, p + i * 4, 4);
+      else
+        ibs.read(reinterpret_cast<char *>(b), 4);
+      uint32_t u = ((uint32_t)b[0]
+                    | ((uint32_t)b[1] << 8)
+                    | ((uint32_t)b[2] << 16)
+                    | ((uint32_t)b[3] << 24));
+      memcpy(&v[i], &u, 4);
+    }
+  fv = std::move(v);
+  return ibs;
+}
+
 template<typename T>
 using Vector = BasedVector<T, 0>;
 
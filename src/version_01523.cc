@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+8+5 (git sha1 28680ef, g++ 12.2.0-14+deb12u1 -O2)";
@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+1+0 (git sha1 ece00e4, g++ 12.2.0-14+deb12u1 -O2)";
@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+48+4 (git sha1 1cfb2c9, g++ 12.2.0-14+deb12u1 -O2)";
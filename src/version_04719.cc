@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+5+3 (git sha1 7af2632, g++ 12.2.0-14+deb12u1 -O2)";
@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+23+4 (git sha1 754f809, g++ 12.2.0-14+deb12u1 -O2)";
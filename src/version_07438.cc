@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+35+3 (git sha1 81c806a, g++ 12.2.0-14+deb12u1 -O2)";
@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+22+0 (git sha1 e87a768, g++ 12.2.0-14+deb12u1 -O2)";
@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+29+3 (git sha1 75e5a8b, g++ 12.2.0-14+deb12u1 -O2)";
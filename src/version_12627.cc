@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+3+5 (git sha1 8d461ee, g++ 12.2.0-14+deb12u1 -O2)";
@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+49+0 (git sha1 841f078, g++ 12.2.0-14+deb12u1 -O2)";
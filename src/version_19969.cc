@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+9+1 (git sha1 ee8dca0, g++ 12.2.0-14+deb12u1 -O2)";
@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+41+2 (git sha1 223bcae, g++ 12.2.0-14+deb12u1 -O2)";
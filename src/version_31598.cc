@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+44+4 (git sha1 31f7a37, g++ 12.2.0-14+deb12u1 -O2)";
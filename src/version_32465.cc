@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+20+0 (git sha1 d4578f0, g++ 12.2.0-14+deb12u1 -O2)";
@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+33+4 (git sha1 a95da26, g++ 12.2.0-14+deb12u1 -O2)";
@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+19+0 (git sha1 778c291, g++ 12.2.0-14+deb12u1 -O2)";
@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+6+3 (git sha1 d9eeab9, g++ 12.2.0-14+deb12u1 -O2)";
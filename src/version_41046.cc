@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+47+1 (git sha1 f798ea1, g++ 12.2.0-14+deb12u1 -O2)";
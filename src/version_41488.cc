@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+45+1 (git sha1 5d7da37, g++ 12.2.0-14+deb12u1 -O2)";
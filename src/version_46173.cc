@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+15+2 (git sha1 d7f5b82, g++ 12.2.0-14+deb12u1 -O2)";
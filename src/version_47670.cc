@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+10+3 (git sha1 1837355, g++ 12.2.0-14+deb12u1 -O2)";
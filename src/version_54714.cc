@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+37+4 (git sha1 8e46699, g++ 12.2.0-14+deb12u1 -O2)";
@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+26+2 (git sha1 d72648a, g++ 12.2.0-14+deb12u1 -O2)";
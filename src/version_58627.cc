@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+21+0 (git sha1 7411f8b, g++ 12.2.0-14+deb12u1 -O2)";
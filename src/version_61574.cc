@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+40+7 (git sha1 e39df7a, g++ 12.2.0-14+deb12u1 -O2)";
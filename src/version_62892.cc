@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+32+5 (git sha1 d70bcb9, g++ 12.2.0-14+deb12u1 -O2)";
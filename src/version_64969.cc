@@ -0,0 +1 @@
+const char *version_str = "arachne-pnr 0.1+46+0 (git sha1 9a596cb, g++ 12.2.0-14+deb12u1 -O2)";
@@ -0,0 +1,222 @@
+
+#include "chipdb.hh"
+#include "util.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// Times chipdb loading and common queries for one device and prints
+// one JSON object per measurement:
+//
+//   {"device": "1k", "bench": "bread", "value": 1.234, "unit": "ms"}
+//
+// Load times include the first finalize(); "finalize" is a second
+// call.  Query times are the best of 5 passes, per query.
+
+static std::string device;
+
+static void
+report(const std::string &bench, double value, const char *unit)
+{
+  std::cout << "{\"device\": \"" << device
+            << "\", \"bench\": \"" << bench
+            << "\", \"value\": " << value
+            << ", \"unit\": \"" << unit << "\"}\n";
+}
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double
+ms_since(bench_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+}
+
+// resident set size in KB, or -1 if not known
+static long
+current_rss_kb()
+{
+  std::ifstream ifs("/proc/self/statm");
+  long size, resident;
+  if (!(ifs >> size >> resident))
+    return -1;
+  return resident * 4;
+}
+
+template<typename F> static void
+time_query(const std::string &bench, F f)
+{
+  double best = 0;
+  long n = 0;
+  for (int pass = 0; pass < 5; ++pass)
+    {
+      bench_clock::time_point start = bench_clock::now();
+      n = f();
+      double t = ms_since(start);
+      if (pass == 0 || t < best)
+        best = t;
+    }
+  if (n > 0)
+    report(bench, best * 1e6 / n, "ns");
+}
+
+static volatile long sink;
+
+static void
+bench_queries(const ChipDB *chipdb)
+{
+  time_query("loc_cell", [&]() {
+      long sum = 0;
+      for (int r = 0; r < 100; ++r)
+        for (int c = 1; c <= chipdb->n_cells; ++c)
+          sum += chipdb->loc_cell(chipdb->cell_location[c]);
+      sink = sum;
+      return 100l * chipdb->n_cells;
+    });
+  
+  time_query("tile_net_by_name", [&]() {
+      long n = 0, sum = 0;
+      for (int t = 0; t < chipdb->n_tiles; ++t)
+        for (const auto &p : chipdb->tile_nets()[t])
+          {
+            sum += chipdb->tile_net(t, chipdb->net_names().name(p.first));
+            ++n;
+          }
+      sink = sum;
+      return n;
+    });
+  
+  time_query("tile_net_by_id", [&]() {
+      long n = 0, sum = 0;
+      for (int t = 0; t < chipdb->n_tiles; ++t)
+        for (const auto &p : chipdb->tile_nets()[t])
+          {
+            sum += chipdb->tile_net(t, p.first);
+            ++n;
+          }
+      sink = sum;
+      return n;
+    });
+  
+  time_query("switch_iteration", [&]() {
+      long n = 0, sum = 0;
+      for (int t = 0; t < chipdb->n_tiles; ++t)
+        {
+          const std::vector<int> &nets = chipdb->tile_switch_nets()[t];
+          for (const SwitchPattern &sp : chipdb->tile_switches(t))
+            {
+              for (const auto &p : sp.in_val)
+                sum += nets[p.first];
+              ++n;
+            }
+        }
+      sink = sum;
+      return n;
+    });
+  
+  time_query("get_switch", [&]() {
+      long sum = 0;
+      for (int s = 0; s < chipdb->n_switches(); ++s)
+        sum += chipdb->get_switch(s).out;
+      sink = sum;
+      return (long)chipdb->n_switches();
+    });
+  
+  time_query("find_switch", [&]() {
+      const RoutingGraph &g = chipdb->routing_graph();
+      long n = 0, sum = 0;
+      for (int i = 0; i < chipdb->n_nets; ++i)
+        for (int e = g.out_begin[i]; e < g.out_begin[i + 1]; ++e)
+          {
+            sum += chipdb->find_switch(i, g.out_net[e]);
+            ++n;
+          }
+      sink = sum;
+      return n;
+    });
+}
+
+static void
+bench_binary(const std::string &filename)
+{
+  long rss0 = current_rss_kb();
+  
+  bench_clock::time_point start = bench_clock::now();
+  ChipDB *chipdb = read_chipdb(filename);
+  report("bread", ms_since(start), "ms");
+  
+  start = bench_clock::now();
+  chipdb->tile_nets();
+  report("load_tile_nets", ms_since(start), "ms");
+  
+  start = bench_clock::now();
+  chipdb->tile_switch_nets();
+  report("load_switches", ms_since(start), "ms");
+  
+  start = bench_clock::now();
+  chipdb->routing_graph();
+  report("load_routing_graph", ms_since(start), "ms");
+  
+  start = bench_clock::now();
+  chipdb->finalize();
+  report("bin_finalize", ms_since(start), "ms");
+  
+  long rss1 = current_rss_kb();
+  if (rss0 >= 0 && rss1 >= 0)
+    report("bin_rss", rss1 - rss0, "KB");
+  
+  bench_queries(chipdb);
+  delete chipdb;
+}
+
+static void
+bench_text(const std::string &filename)
+{
+  long rss0 = current_rss_kb();
+  
+  bench_clock::time_point start = bench_clock::now();
+  ChipDB *chipdb = read_chipdb(filename);
+  report("text_parse", ms_since(start), "ms");
+  
+  start = bench_clock::now();
+  chipdb->finalize();
+  report("text_finalize", ms_since(start), "ms");
+  
+  long rss1 = current_rss_kb();
+  if (rss0 >= 0 && rss1 >= 0)
+    report("text_rss", rss1 - rss0, "KB");
+  
+  delete chipdb;
+}
+
+int
+main(int argc, const char **argv)
+{
+  if (argc != 4)
+    {
+      std::cerr << "usage: " << argv[0] << " <device> <chipdb.txt> <chipdb.bin>\n";
+      return EXIT_FAILURE;
+    }
+  
+  device = argv[1];
+  std::ostream null_ostream(nullptr);
+  logs = &null_ostream;
+  
+  bench_binary(argv[3]);
+  bench_text(argv[2]);
+  
+#ifndef _WIN32
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) == 0)
+    report("max_rss", ru.ru_maxrss, "KB");
+#endif
+  
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,68 @@
+#!/bin/bash
+
+set -ex
+
+arachne_pnr=../../bin/arachne-pnr
+
+rm -rf 1k
+mkdir 1k
+
+# congested.blif cannot be routed: give up once it stops improving,
+# and report the contested resources
+set +e
+$arachne_pnr -d 1k --route-only --route-stall-passes 5 congested.blif -o 1k/congested.txt 2> 1k/congested.log
+status=$?
+set -e
+if [ x"$status" != x"1" ]; then
+    echo "error, stopping."
+    exit 1
+fi
+grep -q "failed to route: no progress since pass" 1k/congested.log
+grep -A1 "^most contested routing resources:$" 1k/congested.log | grep -q "overused in"
+
+# without --route-stall-passes, it runs to --max-passes
+set +e
+$arachne_pnr -d 1k --route-only --max-passes 10 congested.blif -o 1k/congested.txt 2> 1k/congested2.log
+status=$?
+set -e
+if [ x"$status" != x"1" ]; then
+    echo "error, stopping."
+    exit 1
+fi
+grep -q "^fatal error: failed to route$" 1k/congested2.log
+grep -q "pass 10, " 1k/congested2.log
+
+# warm start: rerouting the same placement from its own .asc keeps
+# every route and reproduces the cold --route-only result
+$arachne_pnr -d 1k ../regression/test1.blif --post-place-blif 1k/test1.place.blif -o 1k/test1.txt
+$arachne_pnr -d 1k --route-only 1k/test1.place.blif -o 1k/test1.cold.txt
+$arachne_pnr -d 1k --route-only 1k/test1.place.blif --route-warm-start 1k/test1.cold.txt -o 1k/test1.warm.txt 2> 1k/warm.log
+grep "warm start: kept routes of" 1k/warm.log > 1k/warm.kept
+n_kept=$(sed 's/.* of \([0-9]*\) \/ \([0-9]*\) nets/\1/' 1k/warm.kept)
+n_nets=$(sed 's/.* of \([0-9]*\) \/ \([0-9]*\) nets/\2/' 1k/warm.kept)
+test "$n_nets" -gt 0
+test "$n_kept" = "$n_nets"
+diff <(grep -v '^\.comment' 1k/test1.cold.txt) <(grep -v '^\.comment' 1k/test1.warm.txt)
+
+# parallel rerouting finds the same routes as serial
+$arachne_pnr -d 1k --route-only --max-passes 10 --route-threads 4 congested.blif -o 1k/congested4.txt 2> 1k/congested4.log || true
+diff <(grep "^  pass " 1k/congested2.log) <(grep "^  pass " 1k/congested4.log)
+$arachne_pnr -d 1k --route-only 1k/test1.place.blif --route-threads 4 -o 1k/test1.threads.txt
+diff <(grep -v '^\.comment' 1k/test1.cold.txt) <(grep -v '^\.comment' 1k/test1.threads.txt)
+
+# warm start from a bad .asc
+sed 's/^\.device .*/.device 8k/' 1k/test1.cold.txt > 1k/wrong_device.txt
+# first row of the first logic tile: truncated, or with a bad bit
+awk '!done && prev ~ /^\.logic_tile/ { $0 = "0101"; done = 1 } { prev = $0; print }' 1k/test1.cold.txt > 1k/short_row.txt
+awk '!done && prev ~ /^\.logic_tile/ { sub(/^./, "x"); done = 1 } { prev = $0; print }' 1k/test1.cold.txt > 1k/bad_bit.txt
+for f in wrong_device:"does not match chipdb device" short_row:"tile bits" bad_bit:"invalid tile bit"; do
+    set +e
+    $arachne_pnr -d 1k --route-only 1k/test1.place.blif --route-warm-start 1k/${f%%:*}.txt -o /dev/null 2> 1k/${f%%:*}.log
+    status=$?
+    set -e
+    if [ x"$status" != x"1" ]; then
+        echo "error, stopping."
+        exit 1
+    fi
+    grep -q "${f#*:}" 1k/${f%%:*}.log
+done
@@ -0,0 +1,258 @@
+
+#include "chipdb.hh"
+#include "util.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+const char *version_str = "test_chipdb";
+
+void
+test_symbol_table(random_generator &rg)
+{
+  SymbolTable empty;
+  assert(empty.size() == 0);
+  assert(empty.id("") == -1);
+  
+  std::vector<std::string> names;
+  for (int i = 0; i < 1000; ++i)
+    names.push_back(fmt("sp4_h_r_" << random_int(0, 499, rg)));
+  names.push_back("");
+  names.push_back("glb_netwk_0");
+  
+  SymbolTable st(names);
+  
+  // interned: each name once, and ids order like the names
+  for (const std::string &name : names)
+    {
+      int i = st.id(name);
+      assert(i >= 0 && i < st.size());
+      assert(st.name(i) == name);
+    }
+  for (int i = 0; i < st.size(); ++i)
+    {
+      assert(st.id(st.name(i)) == i);
+      if (i > 0)
+        assert(st.name(i - 1) < st.name(i));
+    }
+  assert(st.id("sp4_h_r_500") == -1);
+  assert(st.id("sp4_h_r") == -1);
+  assert(st.id("zzz") == -1);
+  
+  std::ostringstream os;
+  obstream obs(os);
+  obs << st;
+  
+  std::istringstream is(os.str());
+  ibstream ibs(is);
+  SymbolTable st2;
+  ibs >> st2;
+  assert(st2.size() == st.size());
+  for (int i = 0; i < st.size(); ++i)
+    assert(st2.name(i) == st.name(i));
+}
+
+std::string
+binary_image(const ChipDB *chipdb)
+{
+  std::ostringstream os;
+  obstream obs(os);
+  chipdb->bwrite(obs);
+  return os.str();
+}
+
+void
+test_parallel_parse(const std::string &filename, const std::string &text)
+{
+  ChipDB *serial = parse_chipdb(filename, text.data(), text.size(), 1);
+  std::string serial_image = binary_image(serial);
+  delete serial;
+  
+  for (int n_threads : {2, 3, 7, 16})
+    {
+      ChipDB *parallel = parse_chipdb(filename, text.data(), text.size(),
+                                      n_threads);
+      assert(binary_image(parallel) == serial_image);
+      delete parallel;
+    }
+}
+
+// parse text in a child process, returning what it wrote to stderr
+// if it failed
+std::string
+parse_error(const std::string &filename, const std::string &text,
+            int n_threads)
+{
+  const char *err_file = "test_chipdb.err";
+  pid_t pid = fork();
+  assert(pid >= 0);
+  if (pid == 0)
+    {
+      int fd = open(err_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      dup2(fd, 2);
+      delete parse_chipdb(filename, text.data(), text.size(), n_threads);
+      _exit(0);
+    }
+  
+  int status;
+  waitpid(pid, &status, 0);
+  assert(WIFEXITED(status));
+  if (WEXITSTATUS(status) == 0)
+    return std::string();
+  
+  std::ifstream ifs(err_file);
+  std::string err((std::istreambuf_iterator<char>(ifs)),
+                  std::istreambuf_iterator<char>());
+  std::remove(err_file);
+  return err;
+}
+
+void
+test_parse_errors(const std::string &filename, const std::string &text)
+{
+  // break a .net directive a third and two thirds of the way in
+  std::vector<std::string> lines;
+  std::istringstream is(text);
+  std::string line;
+  while (std::getline(is, line))
+    lines.push_back(line);
+  std::vector<int> net_lines;
+  for (int i = 0; i < (int)lines.size(); ++i)
+    {
+      if (lines[i].compare(0, 5, ".net ") == 0)
+        net_lines.push_back(i);
+    }
+  assert(net_lines.size() >= 3);
+  int first = net_lines[net_lines.size() / 3],
+    second = net_lines[net_lines.size() * 2 / 3];
+  lines[first] += " x";
+  lines[second] += " x";
+  
+  std::string bad;
+  for (const std::string &l : lines)
+    bad += l + "\n";
+  
+  // the first error in the file is reported, however the parse is
+  // split
+  std::string expected = fmt(filename << ":" << first + 1
+                             << ": fatal error: wrong number of arguments\n");
+  for (int n_threads : {1, 2, 3, 16})
+    assert(parse_error(filename, bad, n_threads) == expected);
+}
+
+// files in dir, after removing them if remove is set
+std::vector<std::string>
+cache_files(const std::string &dir, bool remove = false)
+{
+  std::vector<std::string> files;
+  DIR *dp = opendir(dir.c_str());
+  if (!dp)
+    return files;
+  while (struct dirent *e = readdir(dp))
+    {
+      std::string name = e->d_name;
+      if (name == "." || name == "..")
+        continue;
+      files.push_back(name);
+      if (remove)
+        std::remove((dir + "/" + name).c_str());
+    }
+  closedir(dp);
+  return files;
+}
+
+// true if chipdb was read from a binary (the cache), not parsed
+bool
+from_binary(const ChipDB *chipdb)
+{
+  return chipdb->data != nullptr;
+}
+
+void
+test_cache(const std::string &filename, const std::string &text)
+{
+  const std::string dir = "test_chipdb.cache";
+  cache_files(dir, true);
+  
+  // miss, then hit
+  ChipDB *miss = read_chipdb(filename, dir);
+  assert(!from_binary(miss));
+  assert(cache_files(dir).size() == 1);
+  
+  ChipDB *hit = read_chipdb(filename, dir);
+  assert(from_binary(hit));
+  assert(binary_image(hit) == binary_image(miss));
+  delete miss;
+  delete hit;
+  
+  // a changed text chipdb misses
+  const std::string edited = "test_chipdb.txt";
+  {
+    std::ofstream ofs(edited);
+    ofs << "# edited\n" << text;
+  }
+  ChipDB *chipdb = read_chipdb(edited, dir);
+  assert(!from_binary(chipdb));
+  assert(cache_files(dir).size() == 2);
+  delete chipdb;
+  chipdb = read_chipdb(edited, dir);
+  assert(from_binary(chipdb));
+  delete chipdb;
+  std::remove(edited.c_str());
+  
+  // so does another version of arachne-pnr
+  const char *saved_version_str = version_str;
+  version_str = "test_chipdb 2";
+  chipdb = read_chipdb(filename, dir);
+  assert(!from_binary(chipdb));
+  assert(cache_files(dir).size() == 3);
+  delete chipdb;
+  chipdb = read_chipdb(filename, dir);
+  assert(from_binary(chipdb));
+  delete chipdb;
+  version_str = saved_version_str;
+  
+  cache_files(dir, true);
+  rmdir(dir.c_str());
+}
+
+int
+main(int argc, const char **argv)
+{
+  if (argc != 2)
+    {
+      std::cerr << "usage: " << argv[0] << " <chipdb.txt>\n";
+      return EXIT_FAILURE;
+    }
+  
+  std::ostream null_ostream(nullptr);
+  logs = &null_ostream;
+  
+  random_generator rg;
+  
+  test_symbol_table(rg);
+  
+  std::string filename = argv[1];
+  std::ifstream ifs(filename);
+  if (ifs.fail())
+    fatal(fmt("failed to open `" << filename << "'"));
+  std::string text((std::istreambuf_iterator<char>(ifs)),
+                   std::istreambuf_iterator<char>());
+  
+  test_parallel_parse(filename, text);
+  test_parse_errors(filename, text);
+  test_cache(filename, text);
+  
+  return 0;
+}
@@ -0,0 +1,114 @@
+
+#include "configuration.hh"
+#include "chipdb.hh"
+#include "netlist.hh"
+#include "util.hh"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// tile bits of tile t as written by write_txt, one string per row
+std::vector<std::string>
+tile_rows(const std::string &asc, const std::string &header, int bh)
+{
+  std::istringstream is(asc);
+  std::string line;
+  while (std::getline(is, line))
+    {
+      if (line == header)
+        break;
+    }
+  assert(is.good());
+  
+  std::vector<std::string> rows;
+  for (int r = 0; r < bh; ++r)
+    {
+      std::getline(is, line);
+      rows.push_back(line);
+    }
+  return rows;
+}
+
+int
+main()
+{
+  random_generator rg;
+  
+  // a logic tile, and a ram tile exactly 64 bits wide
+  ChipDB chipdb;
+  chipdb.set_device("1k", 2, 2, 0);
+  chipdb.tile_type[0] = TileType::LOGIC;
+  chipdb.tile_type[1] = TileType::RAMB;
+  chipdb.tile_cbits_block_size[TileType::LOGIC] = std::make_pair(54, 16);
+  chipdb.tile_cbits_block_size[TileType::RAMB] = std::make_pair(64, 3);
+  chipdb.finalize();
+  
+  const int n_tiles = 2;
+  const std::string headers[n_tiles] = {
+    ".logic_tile 0 0", ".ramb_tile 1 0",
+  };
+  
+  Configuration conf(&chipdb);
+  
+  // set every bit once, in random order, to a random value
+  std::vector<std::vector<std::string>> expected(n_tiles);
+  std::vector<CBit> cbits;
+  for (int t = 0; t < n_tiles; ++t)
+    {
+      int bw, bh;
+      std::tie(bw, bh) = chipdb.tile_cbits_block_size.at(chipdb.tile_type[t]);
+      expected[t].assign(bh, std::string(bw, '0'));
+      for (int r = 0; r < bh; ++r)
+        for (int c = 0; c < bw; ++c)
+          cbits.push_back(CBit(t, r, c));
+    }
+  for (int i = (int)cbits.size() - 1; i > 0; --i)
+    std::swap(cbits[i], cbits[random_int(0, i, rg)]);
+  
+  // the top columns of a full-width tile first
+  conf.set_cbits({CBit(1, 2, 63), CBit(1, 2, 62)}, 1);
+  expected[1][2][63] = '1';
+  expected[1][2][62] = '0';
+  
+  for (const CBit &cb : cbits)
+    {
+      bool v;
+      if (cb.tile == 1 && cb.row == 2 && cb.col >= 62)
+        v = expected[1][2][cb.col] == '1';
+      else
+        v = random_int(0, 1, rg);
+      conf.set_cbit(cb, v);
+      // setting it again to the same value is fine
+      conf.set_cbit(cb, v);
+      expected[cb.tile][cb.row][cb.col] = v ? '1' : '0';
+    }
+  
+  for (const CBit &cb : cbits)
+    assert(conf.get_cbit(cb) == (expected[cb.tile][cb.row][cb.col] == '1'));
+  
+  Design d;
+  std::ostringstream os;
+  conf.write_txt(os, &d, std::map<Instance *, int, IdLess>(),
+                 std::vector<Net *>());
+  std::string asc = os.str();
+  for (int t = 0; t < n_tiles; ++t)
+    assert(tile_rows(asc, headers[t], expected[t].size()) == expected[t]);
+  
+  // and back
+  const char *filename = "test_conf.asc";
+  {
+    std::ofstream ofs(filename);
+    ofs << asc;
+  }
+  Configuration conf2(&chipdb);
+  conf2.read_txt(filename);
+  std::remove(filename);
+  
+  for (const CBit &cb : cbits)
+    assert(conf2.get_cbit(cb) == conf.get_cbit(cb));
+  
+  return 0;
+}
@@ -0,0 +1,82 @@
+
+#include "vector.hh"
+#include "util.hh"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+void
+check(const FlatVector<int> &fv, const std::vector<int> &v)
+{
+  assert(fv.size() == v.size());
+  for (size_t i = 0; i < v.size(); ++i)
+    assert(fv[i] == v[i]);
+}
+
+void
+test(int n, random_generator &rg)
+{
+  std::vector<int> v;
+  for (int i = 0; i < n; ++i)
+    v.push_back(random_int(-1000000, 1000000, rg));
+  
+  std::vector<int> v2 = v;
+  FlatVector<int> a(std::move(v2));
+  assert(a.owned());
+  check(a, v);
+  
+  FlatVector<int> b(a);
+  check(b, v);
+  
+  // unaligned prefix before the array
+  std::ostringstream os;
+  obstream obs(os);
+  obs << std::string("x") << a << 42;
+  std::string s = os.str();
+  
+  {
+    std::istringstream is(s);
+    ibstream ibs(is);
+    std::string x;
+    FlatVector<int> c;
+    int k;
+    ibs >> x >> c >> k;
+    assert(x == "x");
+    assert(c.owned());
+    check(c, v);
+    assert(k == 42);
+  }
+  
+  {
+    // in place
+    ibstream ibs(s.data(), s.size());
+    std::string x;
+    FlatVector<int> c;
+    int k;
+    ibs >> x >> c >> k;
+    assert(x == "x");
+    if (n > 0
+        && host_is_little_endian())
+      {
+        assert(!c.owned());
+        assert(reinterpret_cast<const char *>(c.data()) > s.data()
+               && reinterpret_cast<const char *>(c.data()) < s.data() + s.size());
+      }
+    check(c, v);
+    assert(k == 42);
+    
+    FlatVector<int> d(std::move(c));
+    check(d, v);
+  }
+}
+
+int
+main()
+{
+  random_generator rg;
+  
+  for (int n = 0; n <= 100; ++n)
+    test(n, rg);
+  test(10000, rg);
+}
@@ -0,0 +1,109 @@
+
+#include "routestore.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <vector>
+
+// compare s against routes, the edges of each net in order
+void
+check(const RouteStore &s,
+      const std::vector<std::vector<std::pair<int, int>>> &routes)
+{
+  int n_nodes = s.n_nodes();
+  std::vector<std::vector<int>> node_nets(n_nodes);
+  for (int i = 0; i < (int)routes.size(); ++i)
+    {
+      std::vector<std::pair<int, int>> r;
+      for (const auto &p : s[i])
+        r.push_back(p);
+      assert(r == routes[i]);
+      assert(s[i].size() == (int)routes[i].size());
+      assert(s[i].empty() == routes[i].empty());
+      
+      for (const auto &p : routes[i])
+        node_nets[p.second].push_back(i);
+    }
+  
+  for (int j = 0; j < n_nodes; ++j)
+    {
+      std::vector<int> nets;
+      for (int i : s.node_nets(j))
+        nets.push_back(i);
+      std::sort(nets.begin(), nets.end());
+      assert(nets == node_nets[j]);
+      assert(s.node_nets(j).empty() == node_nets[j].empty());
+    }
+}
+
+void
+test(int n_nets, int n_nodes, random_generator &rg)
+{
+  RouteStore s(n_nodes);
+  s.resize(n_nets);
+  assert(s.n_nets() == n_nets);
+  
+  std::vector<std::vector<std::pair<int, int>>> routes(n_nets);
+  check(s, routes);
+  
+  for (int k = 0; k < 20 * n_nets; ++k)
+    {
+      int i = random_int(0, n_nets - 1, rg);
+      if (random_int(0, 9, rg) == 0)
+        {
+          s.clear(i);
+          routes[i].clear();
+        }
+      else
+        {
+          // routes are trees: a net uses each node at most once
+          int node = random_int(0, n_nodes - 1, rg);
+          bool used = false;
+          for (const auto &p : routes[i])
+            {
+              if (p.second == node)
+                used = true;
+            }
+          if (used)
+            continue;
+          
+          int prev = random_int(0, n_nodes - 1, rg);
+          s.add(i, prev, node);
+          routes[i].push_back(std::make_pair(prev, node));
+        }
+    }
+  check(s, routes);
+  
+  // rip everything up and reroute, reusing the freed storage
+  for (int i = 0; i < n_nets; ++i)
+    {
+      s.clear(i);
+      routes[i].clear();
+    }
+  check(s, routes);
+  
+  for (int i = 0; i < n_nets; ++i)
+    for (int j = 0; j < i % 40; ++j)
+      {
+        s.add(i, j, (i + j) % n_nodes);
+        routes[i].push_back(std::make_pair(j, (i + j) % n_nodes));
+      }
+  
+  // nets added later start empty
+  s.resize(n_nets + 5);
+  routes.resize(n_nets + 5);
+  check(s, routes);
+}
+
+int
+main()
+{
+  random_generator rg;
+  
+  for (int n = 1; n <= 50; ++n)
+    test(n, 60, rg);
+  test(1000, 100, rg);
+  test(200, 5000, rg);
+  
+  return 0;
+}